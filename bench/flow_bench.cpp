@@ -0,0 +1,276 @@
+// Throughput benchmark: replays seeded synthetic order flow (flow_gen.h)
+// through SimpleCross::action and reports actions/orders/fills per second
+// and how many times the system allocator was called while matching.
+//
+// usage: flow_bench [--key=value ...]
+//   --seed --actions --symbols --zipf --walk --cancel --marketable --depth
+//   --malformed --ioc
+//   --text=1   use the results_t action() instead of an EventSink
+//   --throwing=1 parse with the throwing parse_request() and catch errors
+//   --out=FILE also write the generated flow to FILE
+//   --journal=FILE  journal accepted actions to FILE (truncated first),
+//                   --sync_every=N --sync_us=T set the group commit policy
+//   --snapshot=FILE time saving the final book to FILE and loading it back
+//   --cancel_all=1  time a whole book C of the final book
+//   --band=TICKS    dense price ladder for every symbol, TICKS (up to 2047)
+//                   either side of the starting mid (prices past it use the map)
+//   --shards=N,...  instead run the flow through ShardedCross at each shard
+//                   count, against a single SimpleCross (both results_t),
+//                   and check every request's results match
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <thread>
+#include "flow_gen.h"
+#include "sharded_cross.h"
+#include "simple_cross.h"
+
+//Atomic, the --shards workers allocate too
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(std::size_t n){
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if(void* p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t n){ return operator new(n); }
+void* operator new(std::size_t n, std::align_val_t a){
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  std::size_t align = static_cast<std::size_t>(a);
+  if(void* p = std::aligned_alloc(align, (n + align - 1) / align * align))
+    return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t a){ return operator new(n, a); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+class CountingSink : public EventSink
+{
+  public:
+    std::size_t fills = 0;
+    std::size_t errors = 0;
+    void event(const event_t& ev) override {
+      fills += ev.type == 'F';
+      errors += ev.type == 'E';
+    }
+};
+
+/*
+ * Sharded throughput and equivalence
+ *
+ * The flow runs once through a single SimpleCross and then through a
+ * ShardedCross per shard count, keeping up to WINDOW requests in flight.
+ * Results are compared request by request once timing is done. A whole
+ * book P or C lists symbols grouped by shard, so its rows are compared
+ * as a sorted set.
+*/
+int run_sharded(const std::vector<std::string>& lines, const std::string& counts){
+  const std::size_t WINDOW = 1024;
+  std::vector<results_t> expected;
+  expected.reserve(lines.size());
+  SimpleCross single;
+  auto t0 = std::chrono::steady_clock::now();
+  for(const auto& line : lines)
+    expected.push_back(single.action(line));
+  double single_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::printf("hardware threads %u\n", std::thread::hardware_concurrency());
+  std::printf("single        %12.0f actions/s\n", lines.size() / single_s);
+
+  int status = 0;
+  for(std::size_t pos = 0; pos < counts.size();){
+    std::size_t comma = std::min(counts.find(',', pos), counts.size());
+    unsigned int shards = std::stoul(counts.substr(pos, comma - pos));
+    pos = comma + 1;
+    std::vector<results_t> got;
+    got.reserve(lines.size());
+    double secs;
+    {
+      ShardedCross sharded(shards);
+      auto s0 = std::chrono::steady_clock::now();
+      for(const auto& line : lines){
+        sharded.submit(line);
+        if(sharded.outstanding() >= WINDOW)
+          got.push_back(sharded.next());
+      }
+      while(sharded.outstanding() > 0)
+        got.push_back(sharded.next());
+      secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - s0).count();
+    }
+    std::size_t mismatches = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i){
+      if(got[i] == expected[i])
+        continue;
+      got[i].sort();
+      expected[i].sort();
+      parse_result_t res = try_parse_request(lines[i]);
+      bool grouped = res.ok() && (res.rq.action == 'P' || res.rq.action == 'C') && res.rq.symbol.empty();
+      mismatches += !grouped || got[i] != expected[i];
+    }
+    std::printf("shards %3u    %12.0f actions/s  %5.2fx  %zu mismatches\n",
+      shards, lines.size() / secs, single_s / secs, mismatches);
+    if(mismatches > 0)
+      status = 1;
+  }
+  return status;
+}
+
+bool parse_arg(const char* arg, const char* key, std::string& val){
+  std::string prefix = std::string("--") + key + "=";
+  if(std::string(arg).compare(0, prefix.size(), prefix) != 0)
+    return false;
+  val = arg + prefix.size();
+  return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  flow_params_t params;
+  bool text = false;
+  bool throwing = false;
+  bool cancel_all = false;
+  px_t band = 0;
+  std::string out, journal_path, snapshot_path, shards, val;
+  journal_config_t journal_config;
+  for(int i = 1; i < argc; ++i){
+    if(parse_arg(argv[i], "seed", val)) params.seed = std::stoull(val);
+    else if(parse_arg(argv[i], "actions", val)) params.actions = std::stoul(val);
+    else if(parse_arg(argv[i], "symbols", val)) params.symbols = std::stoul(val);
+    else if(parse_arg(argv[i], "zipf", val)) params.zipf = std::stod(val);
+    else if(parse_arg(argv[i], "walk", val)) params.walk = std::stoul(val);
+    else if(parse_arg(argv[i], "cancel", val)) params.cancel = std::stod(val);
+    else if(parse_arg(argv[i], "marketable", val)) params.marketable = std::stod(val);
+    else if(parse_arg(argv[i], "depth", val)) params.depth = std::stoul(val);
+    else if(parse_arg(argv[i], "malformed", val)) params.malformed = std::stod(val);
+    else if(parse_arg(argv[i], "ioc", val)) params.ioc = std::stod(val);
+    else if(parse_arg(argv[i], "text", val)) text = val == "1";
+    else if(parse_arg(argv[i], "throwing", val)) throwing = val == "1";
+    else if(parse_arg(argv[i], "cancel_all", val)) cancel_all = val == "1";
+    else if(parse_arg(argv[i], "band", val)) band = std::stoll(val);
+    else if(parse_arg(argv[i], "shards", val)) shards = val;
+    else if(parse_arg(argv[i], "out", val)) out = val;
+    else if(parse_arg(argv[i], "journal", val)) journal_path = val;
+    else if(parse_arg(argv[i], "snapshot", val)) snapshot_path = val;
+    else if(parse_arg(argv[i], "sync_every", val)) journal_config.sync_every = std::stoul(val);
+    else if(parse_arg(argv[i], "sync_us", val)) journal_config.sync_us = std::stoul(val);
+    else {
+      std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  flow_stats_t stats;
+  std::vector<std::string> lines = generate_flow(params, stats);
+  if(!out.empty()){
+    std::ofstream file(out);
+    for(const auto& line : lines)
+      file << line << '\n';
+  }
+  if(!shards.empty())
+    return run_sharded(lines, shards);
+
+  SimpleCross scross;
+  for(unsigned int i = 0; band > 0 && i < params.symbols; ++i)
+    scross.set_price_band("S" + std::to_string(i), 100 * PX_SCALE - band * params.tick,
+      100 * PX_SCALE + band * params.tick, params.tick);
+  std::unique_ptr<Journal> journal;
+  if(!journal_path.empty()){
+    ::unlink(journal_path.c_str());
+    journal.reset(new Journal(journal_path.c_str(), journal_config));
+    scross.set_journal(journal.get());
+  }
+  CountingSink sink;
+  std::size_t result_lines = 0;
+  uint64_t allocs0 = g_allocs;
+  auto t0 = std::chrono::steady_clock::now();
+  if(text){
+    for(const auto& line : lines){
+      results_t res = scross.action(line);
+      result_lines += res.size();
+      for(const auto& r : res)
+        sink.fills += r[0] == 'F';
+    }
+  }
+  else if(throwing){
+    std::string text;
+    for(const auto& line : lines){
+      try {
+        scross.execute(parse_request(line), sink);
+      }
+      catch(std::invalid_argument& e) {
+        text = e.what();
+        sink.event(event_t{'E', 0, false, 0, 0, 0, std::string_view(), std::string_view(text).substr(2)});
+      }
+    }
+  }
+  else {
+    for(const auto& line : lines)
+      scross.action(line, sink);
+  }
+  if(journal)
+    journal->commit();
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  uint64_t allocs = g_allocs - allocs0;
+
+  const pool_stats_t& pool = scross.pool_stats();
+  std::printf("seed %llu  symbols %u  zipf %.2f  walk %u  cancel %.2f  marketable %.2f  depth %u  malformed %.2f  ioc %.2f  %s\n",
+    static_cast<unsigned long long>(params.seed), params.symbols, params.zipf, params.walk,
+    params.cancel, params.marketable, params.depth, params.malformed, params.ioc,
+    text ? "results_t" : throwing ? "throwing" : "EventSink");
+  std::printf("actions       %12zu  %12.0f /s\n", params.actions, params.actions / secs);
+  std::printf("orders        %12zu  %12.0f /s\n", stats.orders, stats.orders / secs);
+  std::printf("cancels       %12zu  %12.0f /s\n", stats.cancels, stats.cancels / secs);
+  std::printf("fills         %12zu  %12.0f /s\n", sink.fills / 2, sink.fills / 2 / secs);
+  std::printf("errors        %12zu  (%zu malformed lines)\n", sink.errors, stats.malformed);
+  std::printf("elapsed       %12.3f s\n", secs);
+  std::printf("allocations   %12llu  (%.3f per action)\n", static_cast<unsigned long long>(allocs),
+    static_cast<double>(allocs) / params.actions);
+  std::printf("order pool    %12llu slabs, %llu live\n", static_cast<unsigned long long>(pool.slabs),
+    static_cast<unsigned long long>(pool.live));
+  const pool_stats_t& level_pool = scross.level_stats();
+  std::printf("level pool    %12llu slabs, %llu live\n", static_cast<unsigned long long>(level_pool.slabs),
+    static_cast<unsigned long long>(level_pool.live));
+  if(band > 0)
+    std::printf("price band    %12lld ticks either side of 100\n", static_cast<long long>(band));
+  if(journal)
+    std::printf("journal       %12llu records, %llu syncs (every %u / %u us)\n",
+      static_cast<unsigned long long>(journal->durable()), static_cast<unsigned long long>(journal->syncs()),
+      journal_config.sync_every, journal_config.sync_us);
+  if(!snapshot_path.empty()){
+    auto s0 = std::chrono::steady_clock::now();
+    scross.save_snapshot(snapshot_path.c_str());
+    auto s1 = std::chrono::steady_clock::now();
+    SimpleCross restored;
+    restored.load_snapshot(snapshot_path.c_str());
+    auto s2 = std::chrono::steady_clock::now();
+    std::printf("snapshot      %12.3f ms save, %.3f ms load (%.3f s to replay)\n",
+      std::chrono::duration<double, std::milli>(s1 - s0).count(),
+      std::chrono::duration<double, std::milli>(s2 - s1).count(), secs);
+  }
+  if(cancel_all){
+    CountingSink cancels;
+    uint64_t live = pool.live;
+    auto c0 = std::chrono::steady_clock::now();
+    scross.action("C", cancels);
+    double c_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - c0).count();
+    std::printf("cancel all    %12llu orders in %.3f ms\n", static_cast<unsigned long long>(live), c_ms);
+  }
+  return 0;
+}
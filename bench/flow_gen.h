@@ -0,0 +1,174 @@
+#ifndef FLOW_GEN_H
+#define FLOW_GEN_H
+
+// Seeded synthetic order flow for the benchmarks.
+//
+// Every action picks a symbol from a Zipf distribution and moves that
+// symbol's mid price by a random walk. It is then either a cancel of a
+// random live order or a new order: marketable orders are priced through
+// the opposite side, passive ones are spread over the first depth ticks
+// of their own side.
+//
+// A share of the actions can be replaced by malformed lines, spread over
+// the parser's error cases, to measure the cost of rejecting input.
+//
+// The flow is generated against a shadow SimpleCross so cancels only
+// target orders that are actually still resting.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "simple_cross.h"
+
+typedef struct FlowParams
+{
+  uint64_t seed = 1;
+  std::size_t actions = 1000000;
+  unsigned int symbols = 100;
+  double zipf = 1.0;          //symbol skew exponent, 0 is uniform
+  unsigned int walk = 2;      //max mid move per action, in ticks
+  double cancel = 0.4;        //share of actions that are X
+  double marketable = 0.1;    //share of new orders priced to cross
+  unsigned int depth = 20;    //passive orders rest within depth ticks of mid
+  px_t tick = PX_SCALE / 100; //price increment
+  double malformed = 0.0;     //share of actions that are malformed lines
+  double ioc = 0.0;           //share of marketable orders sent as IOC
+} flow_params_t;
+
+typedef struct FlowStats
+{
+  std::size_t orders = 0;
+  std::size_t cancels = 0;
+  std::size_t malformed = 0;
+} flow_stats_t;
+
+namespace flow {
+
+/*
+ * Tracks resting quantity of generated orders from the shadow book's fills
+*/
+class LiveOrders : public EventSink
+{
+  public:
+    std::vector<unsigned int> oids;
+    std::unordered_map<unsigned int, std::pair<std::size_t, unsigned int>> qty; //oid -> index, open qty
+
+    void add(unsigned int oid, unsigned int open){
+      qty[oid] = {oids.size(), open};
+      oids.push_back(oid);
+    }
+    void remove(unsigned int oid){
+      auto it = qty.find(oid);
+      std::size_t i = it->second.first;
+      oids[i] = oids.back();
+      qty[oids[i]].first = i;
+      oids.pop_back();
+      qty.erase(it);
+    }
+    void event(const event_t& ev) override {
+      if(ev.type != 'F' && ev.type != 'X')
+        return;
+      auto it = qty.find(ev.oid);
+      //An X here is the cancelled remainder of an IOC
+      if(it != qty.end() && (ev.type == 'X' || (it->second.second -= ev.qty) == 0))
+        remove(ev.oid);
+    }
+};
+
+/*
+ * A line the parser rejects, cycling through its error cases
+*/
+inline std::string malformed_line(uint64_t r, unsigned int oid, unsigned int sym){
+  std::string id = std::to_string(oid);
+  std::string symbol = "S" + std::to_string(sym);
+  switch(r % 8){
+    case 0: return "Q " + id;
+    case 1: return "O -" + id + " " + symbol + " B 10 100.0";
+    case 2: return "O " + id + " " + symbol + " B 0 100.0";
+    case 3: return "O " + id + " " + symbol + " Z 10 100.0";
+    case 4: return "O " + id + " " + symbol + " S 10 1e5";
+    case 5: return "O " + id + " s" + std::to_string(sym) + " B 10 100.0";
+    case 6: return "X " + id + "x";
+    default: return "O " + id + " " + symbol;
+  }
+}
+
+inline std::string order_line(unsigned int oid, unsigned int sym, char side, unsigned int qty, px_t px, bool ioc = false){
+  char buf[PX_MAX_CHARS];
+  return "O " + std::to_string(oid) + " S" + std::to_string(sym) + " " + side + " " +
+    std::to_string(qty) + " " + std::string(buf, format_px(px, buf) - buf) + (ioc ? " IOC" : "");
+}
+
+}
+
+/*
+ * Generate params.actions request lines
+ *
+ * @param params - flow shape
+ *        stats  - counts of each action generated
+ * @return lines - the actions, reproducible for a given params
+*/
+inline std::vector<std::string> generate_flow(const flow_params_t& params, flow_stats_t& stats){
+  std::mt19937_64 rng(params.seed);
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+
+  std::vector<double> cdf(params.symbols);
+  double total = 0;
+  for(unsigned int i = 0; i < params.symbols; ++i)
+    cdf[i] = total += 1.0 / std::pow(i + 1, params.zipf);
+  for(auto& c : cdf)
+    c /= total;
+
+  std::vector<px_t> mid(params.symbols, 100 * PX_SCALE);
+  const px_t floor_px = (params.depth + params.walk + 1) * params.tick;
+  SimpleCross shadow;
+  flow::LiveOrders live;
+  std::vector<std::string> lines;
+  lines.reserve(params.actions);
+  unsigned int oid = 1;
+
+  for(std::size_t i = 0; i < params.actions; ++i){
+    unsigned int sym = static_cast<unsigned int>(std::lower_bound(cdf.begin(), cdf.end(), uni(rng)) - cdf.begin());
+    if(sym >= params.symbols)
+      sym = params.symbols - 1;
+    if(params.walk > 0){
+      mid[sym] += (static_cast<px_t>(rng() % (2 * params.walk + 1)) - params.walk) * params.tick;
+      mid[sym] = std::max(mid[sym], floor_px);
+    }
+
+    std::string line;
+    if(params.malformed > 0 && uni(rng) < params.malformed){
+      line = flow::malformed_line(rng(), oid, sym);
+      ++stats.malformed;
+    }
+    else if(uni(rng) < params.cancel && !live.oids.empty()){
+      unsigned int victim = live.oids[rng() % live.oids.size()];
+      live.remove(victim);
+      line = "X " + std::to_string(victim);
+      ++stats.cancels;
+    }
+    else {
+      char side = rng() & 1 ? 'B' : 'S';
+      unsigned int qty = 1 + static_cast<unsigned int>(rng() % 100);
+      px_t offset = params.depth > 0 ? static_cast<px_t>(1 + rng() % params.depth) * params.tick : 0;
+      bool ioc = false;
+      if(uni(rng) < params.marketable){
+        offset = -static_cast<px_t>(params.depth + 1) * params.tick;
+        ioc = params.ioc > 0 && uni(rng) < params.ioc;
+      }
+      px_t px = side == 'B' ? mid[sym] - offset : mid[sym] + offset;
+      line = flow::order_line(oid, sym, side, qty, px, ioc);
+      live.add(oid, qty);
+      ++oid;
+      ++stats.orders;
+    }
+    shadow.action(line, live);
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+#endif
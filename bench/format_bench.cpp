@@ -0,0 +1,52 @@
+// Formatter microbenchmark: "F oid sym qty px" lines built with
+// std::to_string concatenation (the old handle_cross path) against
+// format_event() into a stack buffer and into a std::string.
+//
+// usage: format_bench [events]
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "events.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+int main(int argc, char **argv)
+{
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 5000000;
+  std::mt19937 rng(3);
+  std::vector<event_t> events(n);
+  for(auto& ev : events)
+    ev = event_t{'F', 'B', true, static_cast<unsigned short>(1 + rng() % 1000),
+                 static_cast<unsigned int>(10000 + rng() % 1000000),
+                 static_cast<px_t>(rng() % 100000000), "IBM", std::string_view()};
+
+  std::size_t sink = 0;
+  auto t0 = bench_clock::now();
+  for(const auto& ev : events){
+    std::string str = "F " + std::to_string(ev.oid) +
+      " " + std::string(ev.symbol) +
+      " " + std::to_string(ev.qty) +
+      " " + std::to_string(px_to_double(ev.px));
+    sink += str.size();
+  }
+  auto t1 = bench_clock::now();
+  for(const auto& ev : events){
+    char buf[EVENT_MAX_LEN];
+    sink += format_event(ev, buf, sizeof(buf));
+    sink += buf[0];
+  }
+  auto t2 = bench_clock::now();
+  for(const auto& ev : events)
+    sink += format_event(ev).size();
+  auto t3 = bench_clock::now();
+
+  auto ns = [n](bench_clock::duration d){ return std::chrono::duration<double, std::nano>(d).count() / n; };
+  std::printf("events: %zu\n", n);
+  std::printf("std::to_string concat   %7.1f ns/event\n", ns(t1 - t0));
+  std::printf("format_event(buf)       %7.1f ns/event\n", ns(t2 - t1));
+  std::printf("format_event() string   %7.1f ns/event\n", ns(t3 - t2));
+  std::printf("(checksum %zu)\n", sink);
+  return 0;
+}
@@ -0,0 +1,140 @@
+// Layout benchmark: walks a 1M-order book stored three ways
+//   legacy - per-level vectors of shared_ptr<order_t> with an embedded
+//            std::string symbol, as the heap book kept them
+//   fat    - pooled order with hot and cold fields in one record
+//   split  - pooled order_t (32 byte hot record) + order_info_t
+// The pooled layouts are walked both level by level through the FIFO
+// links and as a straight scan over the slots.
+//
+// usage: layout_bench [orders] [levels]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "simple_cross.h"
+
+typedef struct LegacyOrder
+{
+  unsigned short fill_qty;
+  unsigned short open_qty;
+  double fill_px;
+  double ord_px;
+  unsigned int oid;
+  std::string symbol;
+  char side;
+} legacy_order_t;
+
+typedef struct FatOrder
+{
+  px_t ord_px;
+  px_t fill_px;
+  level_t* level;
+  unsigned int oid;
+  unsigned int sym_id;
+  handle_t prev;
+  handle_t next;
+  unsigned short open_qty;
+  unsigned short fill_qty;
+  char side;
+} fat_order_t;
+
+typedef std::chrono::steady_clock bench_clock;
+
+const int PASSES = 10;
+
+template <typename F>
+double time_walk(F walk, long long& sink){
+  auto t0 = bench_clock::now();
+  for(int i = 0; i < PASSES; ++i)
+    sink += walk();
+  return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+/*
+ * Link n pooled orders into levels FIFO lists, allocated in random level
+ * order the way interleaved order flow fills a pool.
+*/
+template <typename P>
+std::vector<handle_t> build(P& pool, const std::vector<unsigned>& level_of, std::size_t levels){
+  std::vector<handle_t> heads(levels, NULL_HANDLE), tails(levels, NULL_HANDLE);
+  for(std::size_t i = 0; i < level_of.size(); ++i){
+    handle_t h = pool.alloc();
+    auto& o = pool[h];
+    unsigned l = level_of[i];
+    o.ord_px = 100 * PX_SCALE + l;
+    o.oid = static_cast<unsigned int>(i);
+    o.open_qty = static_cast<unsigned short>(1 + i % 100);
+    o.prev = tails[l];
+    o.next = NULL_HANDLE;
+    if(tails[l] != NULL_HANDLE)
+      pool[tails[l]].next = h;
+    else
+      heads[l] = h;
+    tails[l] = h;
+  }
+  return heads;
+}
+
+template <typename P>
+long long scan(const P& pool, std::size_t n){
+  long long sum = 0;
+  for(handle_t h = 0; h < n; ++h)
+    sum += pool[h].ord_px * pool[h].open_qty;
+  return sum;
+}
+
+template <typename P>
+long long walk(const P& pool, const std::vector<handle_t>& heads){
+  long long sum = 0;
+  for(handle_t head : heads)
+    for(handle_t h = head; h != NULL_HANDLE; h = pool[h].next)
+      sum += pool[h].ord_px * pool[h].open_qty;
+  return sum;
+}
+
+int main(int argc, char **argv)
+{
+  std::size_t n = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  std::size_t levels = argc > 2 ? std::stoul(argv[2]) : 1000;
+  std::mt19937 rng(7);
+  std::vector<unsigned> level_of(n);
+  for(auto& l : level_of)
+    l = rng() % levels;
+
+  std::vector<std::vector<std::shared_ptr<legacy_order_t>>> legacy(levels);
+  for(std::size_t i = 0; i < n; ++i){
+    auto o = std::shared_ptr<legacy_order_t>(new LegacyOrder());
+    *o = {0, static_cast<unsigned short>(1 + i % 100), 0, 100.0 + level_of[i], static_cast<unsigned int>(i), "IBM", 'B'};
+    legacy[level_of[i]].push_back(o);
+  }
+  Pool<fat_order_t, char> fat;
+  auto fat_heads = build(fat, level_of, levels);
+  order_pool_t split;
+  auto split_heads = build(split, level_of, levels);
+
+  long long sink = 0;
+  double legacy_s = time_walk([&]{
+    long long sum = 0;
+    for(const auto& level : legacy)
+      for(const auto& o : level)
+        sum += static_cast<long long>(o->ord_px * o->open_qty);
+    return sum;
+  }, sink);
+  double fat_s = time_walk([&]{ return walk(fat, fat_heads); }, sink);
+  double split_s = time_walk([&]{ return walk(split, split_heads); }, sink);
+  double fat_scan_s = time_walk([&]{ return scan(fat, n); }, sink);
+  double split_scan_s = time_walk([&]{ return scan(split, n); }, sink);
+
+  double walked = static_cast<double>(n) * PASSES;
+  std::printf("orders: %zu  levels: %zu  passes: %d\n", n, levels, PASSES);
+  std::printf("                          level walk   slot scan\n");
+  std::printf("legacy  %3zu bytes/order  %6.2f ns         -\n", sizeof(legacy_order_t), legacy_s * 1e9 / walked);
+  std::printf("fat     %3zu bytes/order  %6.2f ns    %6.2f ns\n", sizeof(fat_order_t), fat_s * 1e9 / walked, fat_scan_s * 1e9 / walked);
+  std::printf("split   %3zu bytes/order  %6.2f ns    %6.2f ns\n", sizeof(order_t), split_s * 1e9 / walked, split_scan_s * 1e9 / walked);
+  std::printf("(checksum %lld)\n", sink);
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Amend benchmark: the same stream of order amendments applied as one M
+// per amendment against X followed by an O with a fresh OID.
+//
+// A passive book of resting orders is built first, then every amendment
+// picks a random resting order and either cuts its quantity (same price)
+// or moves it to another passive price on its own side, so both runs see
+// the same book shape throughout.
+//
+// usage: modify_bench [orders] [amends] [symbols]
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "simple_cross.h"
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+typedef struct Resting
+{
+  unsigned int oid;
+  unsigned int sym;
+  char side;
+  unsigned int qty;
+  px_t px;
+} resting_t;
+
+class NullSink : public EventSink
+{
+  public:
+    std::size_t events = 0;
+    void event(const event_t&) override { ++events; }
+};
+
+std::string px_str(px_t px){
+  char buf[PX_MAX_CHARS];
+  return std::string(buf, format_px(px, buf) - buf);
+}
+
+std::string order_line(const resting_t& o){
+  return "O " + std::to_string(o.oid) + " S" + std::to_string(o.sym) + " " + o.side + " " +
+    std::to_string(o.qty) + " " + px_str(o.px);
+}
+
+//Passive price on the order's own side, 1 to 50 ticks away from 100
+px_t passive_px(char side, std::mt19937_64& rng){
+  px_t ticks = 1 + static_cast<px_t>(rng() % 50);
+  return 100 * PX_SCALE + (side == 'S' ? ticks : -ticks) * (PX_SCALE / 100);
+}
+
+double run(const std::vector<std::string>& setup, const std::vector<std::string>& amends, std::size_t& events){
+  SimpleCross scross;
+  NullSink sink;
+  for(const auto& line : setup)
+    scross.action(line, sink);
+  auto t0 = bench_clock::now();
+  for(const auto& line : amends)
+    scross.action(line, sink);
+  double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+  events = sink.events;
+  return secs;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  std::size_t orders = argc > 1 ? std::stoul(argv[1]) : 200000;
+  std::size_t amends = argc > 2 ? std::stoul(argv[2]) : 1000000;
+  unsigned int symbols = argc > 3 ? std::stoul(argv[3]) : 20;
+
+  std::mt19937_64 rng(5);
+  std::vector<resting_t> book(orders);
+  std::vector<std::string> setup;
+  unsigned int next_oid = 1;
+  for(auto& o : book){
+    o.oid = next_oid++;
+    o.sym = static_cast<unsigned int>(rng() % symbols);
+    o.side = rng() & 1 ? 'B' : 'S';
+    o.qty = 100 + static_cast<unsigned int>(rng() % 900);
+    o.px = passive_px(o.side, rng);
+    setup.push_back(order_line(o));
+  }
+
+  std::vector<std::string> modify, cancel_new;
+  for(std::size_t i = 0; i < amends; ++i){
+    resting_t& o = book[rng() % book.size()];
+    if(rng() & 1 && o.qty > 1)
+      o.qty -= 1 + static_cast<unsigned int>(rng() % (o.qty - 1));
+    else {
+      o.qty = 100 + static_cast<unsigned int>(rng() % 900);
+      o.px = passive_px(o.side, rng);
+    }
+    modify.push_back("M " + std::to_string(o.oid) + " " + std::to_string(o.qty) + " " + px_str(o.px));
+    cancel_new.push_back("X " + std::to_string(o.oid));
+    resting_t renewed = o;
+    renewed.oid = next_oid++;
+    cancel_new.push_back(order_line(renewed));
+  }
+
+  std::size_t m_events, xo_events;
+  double m_s = run(setup, modify, m_events);
+  double xo_s = run(setup, cancel_new, xo_events);
+  std::printf("book:     %zu orders, %u symbols, %zu amends\n", orders, symbols, amends);
+  std::printf("M:        %8.3f s  %8.1f ns/amend\n", m_s, m_s * 1e9 / amends);
+  std::printf("X + O:    %8.3f s  %8.1f ns/amend\n", xo_s, xo_s * 1e9 / amends);
+  std::printf("speedup:  %8.2fx\n", xo_s / m_s);
+  std::printf("events:   %zu M, %zu X + O\n", m_events, xo_events);
+  return 0;
+}
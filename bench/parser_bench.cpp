@@ -0,0 +1,164 @@
+// Parser benchmark: compares parse_request() against the original
+// istringstream/regex/lexical_cast parser on a generated action file.
+//
+// usage: parser_bench [lines] [file]
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "boost/lexical_cast.hpp"
+#include "request_parser.h"
+
+typedef struct LegacyRequest
+{
+  char action;
+  unsigned int oid;
+  std::string symbol;
+  char side;
+  unsigned short qty;
+  double px;
+} legacy_request_t;
+
+/*
+ * The parser SimpleCross::handle_request used before parse_request(),
+ * kept verbatim as the baseline.
+*/
+legacy_request_t legacy_parse(const std::string& line){
+  if(line == "")
+    throw std::invalid_argument("E Missing arguments");
+  legacy_request_t rq;
+  if(line == "P"){
+    rq.action = 'P';
+    return rq;
+  }
+  std::istringstream iss(line);
+  std::vector<std::string> in{std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{}};
+  
+  if(!std::regex_match(in[0], std::regex("[OX]")))
+    throw std::invalid_argument("E Invalid action type: " + in[0]);
+  rq.action = in[0].at(0);
+  if((rq.action == 'X' && in.size() < 2) | (rq.action == 'O' && in.size() < 6))
+    throw std::invalid_argument("E Missing arguments");
+  if(std::regex_match(in[1], std::regex("-[0-9]+")))
+    throw std::invalid_argument("E " + in[1] + " OID must be positive");
+  try {
+    rq.oid = boost::lexical_cast<unsigned int>(in[1]);
+  }
+  catch(boost::bad_lexical_cast &) {
+    throw std::invalid_argument("E " + in[1] + " OID must be an unsigned int");
+  }
+  if(rq.action == 'X')
+    return rq;
+  if(!std::regex_match(in[2], std::regex("[A-Z0-9]{1,8}")))
+    throw std::invalid_argument("E " + in[1] + " Invalid symbol: "+ in[2]);
+  rq.symbol = in[2];
+  if(!std::regex_match(in[3], std::regex("[BS]")))
+    throw std::invalid_argument("E " + in[1] + " Invalid side: " + in[3]);
+  rq.side = in[3].at(0);
+  if(std::regex_match(in[4], std::regex("-[0-9]+")))
+    throw std::invalid_argument("E " + in[1] + " QTY must be positive");
+  try {
+    rq.qty = boost::lexical_cast<unsigned int>(in[4]);
+  }
+  catch(boost::bad_lexical_cast &) {
+    throw std::invalid_argument("E " + in[1] + " QTY must be an unsigned short");
+  }
+  if(std::regex_match(in[5], std::regex("-[0-9]+(.*)")))
+    throw std::invalid_argument("E " + in[1] + " PX must be positive");
+  try {
+    rq.px = boost::lexical_cast<double>(in[5]);
+  }
+  catch(boost::bad_lexical_cast &) {
+    throw std::invalid_argument("E " + in[1] + " PX must be a double");
+  }
+  return rq;
+}
+
+/*
+ * Generate a reproducible action file, roughly 1 in 50 lines malformed
+*/
+void generate(const std::string& path, std::size_t lines){
+  static const char* symbols[] = {"IBM", "AAPL", "MSFT", "GOOG", "A1", "BRKB", "XOM", "JPM"};
+  static const char* bad[] = {
+    "Q 1", "X", "O 12 IBM B 10", "X -12", "X 12abc", "O 12 ibm B 10 1.0",
+    "O 12 TOOLONGSYM B 10 1.0", "O 12 IBM Z 10 1.0", "O 12 IBM B -10 1.0",
+    "O 12 IBM B ten 1.0", "O 12 IBM B 10 -1.0", "O 12 IBM B 10 1.0.0"
+  };
+  std::mt19937 rng(42);
+  std::ofstream out(path);
+  unsigned int oid = 10000;
+  for(std::size_t i = 0; i < lines; ++i){
+    unsigned int r = rng() % 100;
+    if(r < 2)
+      out << bad[rng() % (sizeof(bad) / sizeof(bad[0]))] << '\n';
+    else if(r < 3)
+      out << "P\n";
+    else if(r < 40)
+      out << "X " << (oid - rng() % 1000) << '\n';
+    else {
+      char px[32];
+      std::snprintf(px, sizeof(px), "%.5f", 50 + (rng() % 10000) / 100.0);
+      out << "O " << oid++ << ' ' << symbols[rng() % 8] << ' '
+          << ((rng() & 1) ? 'B' : 'S') << ' ' << 1 + rng() % 500 << ' ' << px << '\n';
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::size_t lines = argc > 1 ? std::stoul(argv[1]) : 200000;
+  std::string path = argc > 2 ? argv[2] : "bench_actions.txt";
+  generate(path, lines);
+
+  std::vector<std::string> input;
+  std::ifstream in(path);
+  for(std::string line; std::getline(in, line);)
+    input.push_back(line);
+
+  typedef std::chrono::steady_clock clock;
+  std::size_t errors = 0, mismatches = 0;
+  unsigned long checksum = 0;
+
+  auto t0 = clock::now();
+  std::vector<std::string> legacy_errors;
+  for(const auto& line : input){
+    try {
+      legacy_request_t rq = legacy_parse(line);
+      checksum += rq.action == 'O' ? rq.oid + rq.qty : 0;
+    }
+    catch(std::invalid_argument& e) {
+      ++errors;
+      legacy_errors.push_back(e.what());
+    }
+  }
+  auto t1 = clock::now();
+  std::size_t e = 0;
+  for(const auto& line : input){
+    try {
+      request_t rq = parse_request(line);
+      checksum -= rq.action == 'O' ? rq.oid + rq.qty : 0;
+    }
+    catch(std::invalid_argument& ex) {
+      if(e >= legacy_errors.size() || legacy_errors[e++] != ex.what())
+        ++mismatches;
+    }
+  }
+  auto t2 = clock::now();
+  if(e != legacy_errors.size() || checksum != 0)
+    ++mismatches;
+
+  double legacy_s = std::chrono::duration<double>(t1 - t0).count();
+  double fast_s = std::chrono::duration<double>(t2 - t1).count();
+  std::printf("lines:        %zu (%zu malformed)\n", input.size(), errors);
+  std::printf("legacy parse: %8.3f s  %10.0f lines/s\n", legacy_s, input.size() / legacy_s);
+  std::printf("parse_request:%8.3f s  %10.0f lines/s\n", fast_s, input.size() / fast_s);
+  std::printf("speedup:      %8.1fx\n", legacy_s / fast_s);
+  std::printf("mismatches:   %zu\n", mismatches);
+  return mismatches != 0;
+}
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Mass cancel (C) by symbol and side, by symbol and for the whole book
+# against a golden output: one X per order in price order, each level
+# head to tail, sells before buys. Cancelled OIDs stay used and an
+# unknown symbol cancels nothing.
+#
+# usage: check/mass_cancel.sh [MAIN]
+set -e
+MAIN=${1:-./main}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/actions.txt" <<ACTIONS
+O 1 IBM B 10 99
+O 2 IBM B 10 100
+O 3 IBM S 10 101
+O 4 IBM S 10 102
+O 5 IBM S 5 101
+O 6 AAPL B 10 50
+O 7 AAPL S 10 51
+O 8 MSFT B 1 10
+C IBM S
+C IBM
+C ZZZ
+O 3 IBM B 1 1
+O 9 AAPL B 5 50
+C AAPL B
+C
+P
+X 7
+O 7 AAPL S 1 1
+C IBM Q
+ACTIONS
+
+cat > "$dir/expected.txt" <<EXPECTED
+X 3
+X 5
+X 4
+X 1
+X 2
+E 3 Duplicate order id
+X 6
+X 9
+X 7
+X 8
+E 7 Order id not in the order book
+E 7 Duplicate order id
+E Invalid side: Q
+EXPECTED
+
+if ! "$MAIN" --replay "$dir/actions.txt" > "$dir/out.txt" || ! diff "$dir/expected.txt" "$dir/out.txt"; then
+  echo "mass cancel: FAILED"
+  exit 1
+fi
+echo "mass cancel: OK"
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Modify (M) priority rules against a golden output: a decrease at the
+# same price keeps the order's place, an increase or a price change
+# sends it to the back of its (new) level, and a price change that
+# crosses fills like a new order. Fully filled orders can't be modified.
+#
+# usage: check/modify.sh [MAIN]
+set -e
+MAIN=${1:-./main}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/actions.txt" <<ACTIONS
+O 1 IBM B 10 100
+O 2 IBM B 10 100
+O 3 IBM B 10 100
+M 1 5 100
+M 2 20 100
+O 4 IBM S 12 100
+P IBM
+O 5 IBM S 10 101
+M 5 10 99.5
+M 5 1 99.5
+M 2 13 99
+O 6 IBM B 4 99
+M 6 2 99
+O 7 IBM S 14 99
+P IBM
+M 9 1 100
+ACTIONS
+
+cat > "$dir/expected.txt" <<EXPECTED
+F 4 IBM 5 100.00000
+F 1 IBM 5 100.00000
+F 4 IBM 7 100.00000
+F 3 IBM 7 100.00000
+P 3 IBM B 3 100.00000
+P 2 IBM B 20 100.00000
+F 5 IBM 3 99.50000
+F 3 IBM 3 99.50000
+F 5 IBM 7 99.50000
+F 2 IBM 7 99.50000
+E 5 Order id not in the order book
+F 7 IBM 13 99.00000
+F 2 IBM 13 99.00000
+F 7 IBM 1 99.00000
+F 6 IBM 1 99.00000
+P 6 IBM B 1 99.00000
+E 9 Order id not in the order book
+EXPECTED
+
+if ! "$MAIN" --replay "$dir/actions.txt" > "$dir/out.txt" || ! diff "$dir/expected.txt" "$dir/out.txt"; then
+  echo "modify: FAILED"
+  exit 1
+fi
+echo "modify: OK"
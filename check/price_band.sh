@@ -0,0 +1,38 @@
+#!/bin/sh
+# Dense price ladder: replay one seeded flow with and without --band and
+# check the output is identical. The flow mixes O (GTC, IOC, FOK), X, M,
+# C and P with prices inside bands of several bitmap words, off their
+# tick and outside them.
+#
+# usage: check/price_band.sh [MAIN]
+set -e
+MAIN=${1:-./main}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk 'BEGIN {
+  srand(25)
+  split("IBM AAPL X1", sym, " ")
+  oid = 1
+  for(i = 0; i < 20000; ++i){
+    s = sym[1 + int(rand() * 3)]
+    px = sprintf("%.2f", 100 + (int(rand() * 241) - 120) * 0.05)
+    r = rand()
+    if(r < 0.25) print "X " 1 + int(rand() * oid)
+    else if(r < 0.35) print "M " 1 + int(rand() * oid) " " 1 + int(rand() * 50) " " px
+    else if(r < 0.36) print "C " s (rand() < 0.5 ? " B" : " S")
+    else if(r < 0.37) print "P " s " " int(rand() * 4)
+    else if(r < 0.42) print "O " oid++ " " s (rand() < 0.5 ? " B " : " S ") 1 + int(rand() * 100) " " px (rand() < 0.5 ? " IOC" : " FOK")
+    else print "O " oid++ " " s (rand() < 0.5 ? " B " : " S ") 1 + int(rand() * 50) " " px
+  }
+  print "P"
+}' > "$dir/flow.txt"
+
+if ! "$MAIN" --replay "$dir/flow.txt" > "$dir/map.txt" ||
+   ! "$MAIN" --replay "$dir/flow.txt" --band IBM:95:105:0.05 --band AAPL:94:106:0.1 \
+       --band X1:99:101:0.01 > "$dir/band.txt" ||
+   ! grep -q '^F ' "$dir/map.txt" || ! diff "$dir/map.txt" "$dir/band.txt" > /dev/null; then
+  echo "price band: FAILED"
+  exit 1
+fi
+echo "price band: OK ($(wc -l < "$dir/band.txt") lines)"
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Snapshot round trip: replay a flow with --snapshot so the book is saved
+# at exit, restart from that snapshot and check P prints the same book.
+# The flow rests orders at a price of 0 and at the smallest price.
+#
+# usage: check/snapshot_roundtrip.sh [MAIN]
+set -e
+MAIN=${1:-./main}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/actions.txt" <<ACTIONS
+O 1 IBM B 10 0
+O 2 IBM B 5 0
+O 3 IBM S 7 100.5
+O 4 IBM B 2 99.25
+O 5 AAPL S 3 0.00001
+O 6 AAPL B 3 0
+X 2
+M 4 1 99.25
+P
+ACTIONS
+echo P > "$dir/print.txt"
+
+"$MAIN" --replay "$dir/actions.txt" --snapshot "$dir/book.snap" | grep '^P ' > "$dir/before.txt"
+if ! "$MAIN" --replay "$dir/print.txt" --snapshot "$dir/book.snap" > "$dir/after.txt" ||
+   ! diff "$dir/before.txt" "$dir/after.txt"; then
+  echo "snapshot round trip: FAILED"
+  exit 1
+fi
+echo "snapshot round trip: OK ($(wc -l < "$dir/after.txt") orders)"
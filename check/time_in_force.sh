@@ -0,0 +1,49 @@
+#!/bin/sh
+# IOC and FOK against a golden output: IOC fills what crosses and
+# cancels the rest, FOK fills in full or is cancelled without a fill,
+# neither ever rests, and their OIDs are used up either way.
+#
+# usage: check/time_in_force.sh [MAIN]
+set -e
+MAIN=${1:-./main}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/actions.txt" <<ACTIONS
+O 1 IBM S 10 100
+O 2 IBM S 10 101
+O 3 IBM B 15 100.5 IOC
+P IBM
+O 4 IBM B 15 101 FOK
+O 5 IBM B 10 101 FOK
+O 6 IBM S 5 99 IOC
+O 4 IBM B 1 1
+O 7 IBM B 5 98
+O 8 IBM S 3 98 IOC
+O 9 IBM S 5 97 FOK
+O 10 IBM B 1 100 GTD
+P IBM
+ACTIONS
+
+cat > "$dir/expected.txt" <<EXPECTED
+F 1 IBM 10 100.00000
+F 3 IBM 10 100.00000
+X 3
+P 2 IBM S 10 101.00000
+X 4
+F 2 IBM 10 101.00000
+F 5 IBM 10 101.00000
+X 6
+E 4 Duplicate order id
+F 8 IBM 3 98.00000
+F 7 IBM 3 98.00000
+X 9
+E 10 Invalid time in force: GTD
+P 7 IBM B 2 98.00000
+EXPECTED
+
+if ! "$MAIN" --replay "$dir/actions.txt" > "$dir/out.txt" || ! diff "$dir/expected.txt" "$dir/out.txt"; then
+  echo "time in force: FAILED"
+  exit 1
+fi
+echo "time in force: OK"
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include "events.h"
+
+namespace {
+
+/*
+ * Bounded append-only writer over a caller buffer
+ *
+ * Counts every character it is given but only stores those that fit,
+ * so the final count is the length the full line needs.
+*/
+class Writer
+{
+  private:
+    char* buf_m;
+    std::size_t len_m;
+    std::size_t n_m = 0;
+  public:
+    Writer(char* buf, std::size_t len) : buf_m(buf), len_m(len) {}
+
+    std::size_t size() const { return n_m; }
+
+    void put(char c){
+      if(n_m < len_m)
+        buf_m[n_m] = c;
+      ++n_m;
+    }
+
+    void put(std::string_view s){
+      if(n_m < len_m)
+        std::memcpy(buf_m + n_m, s.data(), std::min(s.size(), len_m - n_m));
+      n_m += s.size();
+    }
+
+    void put_uint(unsigned int v){
+      char tmp[16];
+      put(std::string_view(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v).ptr - tmp));
+    }
+
+    void put_px(px_t px){
+      char tmp[PX_MAX_CHARS];
+      put(std::string_view(tmp, format_px(px, tmp) - tmp));
+    }
+};
+
+}
+
+/*
+ * Format an event as its RESULT line into a caller buffer
+ *
+ * Writes e.g. "F 10003 IBM 5 100.00000" (no terminator) with integer
+ * formatting only, no allocation and no locale. A buffer of EVENT_MAX_LEN
+ * always holds F, X and P lines. If the line does not fit in len only
+ * the first len characters are written.
+ *
+ * @param ev   - the event to format
+ *        buf  - destination buffer
+ *        len  - size of buf
+ * @return n   - length of the full line
+*/
+std::size_t format_event(const event_t& ev, char* buf, std::size_t len){
+  Writer w(buf, len);
+  w.put(ev.type);
+  switch(ev.type){
+    case 'F':
+      w.put(' ');
+      w.put_uint(ev.oid);
+      w.put(' ');
+      w.put(ev.symbol);
+      w.put(' ');
+      w.put_uint(ev.qty);
+      w.put(' ');
+      w.put_px(ev.px);
+      break;
+    case 'X':
+      w.put(' ');
+      w.put_uint(ev.oid);
+      break;
+    case 'P':
+      w.put(' ');
+      w.put_uint(ev.oid);
+      w.put(' ');
+      w.put(ev.symbol);
+      w.put(' ');
+      w.put(ev.side);
+      w.put(' ');
+      w.put_uint(ev.qty);
+      w.put(' ');
+      w.put_px(ev.px);
+      break;
+    case 'E':
+      if(ev.has_oid){
+        w.put(' ');
+        w.put_uint(ev.oid);
+      }
+      w.put(' ');
+      w.put(ev.text);
+      break;
+  }
+  return w.size();
+}
+
+/*
+ * Format an event as its results_t string
+ *
+ * Only called when text is actually wanted, e.g. by the results_t
+ * adapter in SimpleCross::action.
+ *
+ * @param ev   - the event to format
+ * @return str - the RESULT line, e.g. "F 10003 IBM 5 100.00000"
+*/
+std::string format_event(const event_t& ev){
+  char buf[EVENT_MAX_LEN];
+  std::size_t n = format_event(ev, buf, sizeof(buf));
+  if(n <= sizeof(buf))
+    return std::string(buf, n);
+  std::string str(n, '\0');
+  format_event(ev, &str[0], n);
+  return str;
+}
@@ -0,0 +1,49 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <string>
+#include <string_view>
+#include "price.h"
+
+/*
+ * Typed result of an action
+ *
+ * One event is reported for every line results_t would hold, with type
+ * being that line's RESULT character:
+ *   F - fill of oid for qty at px (one event per side of a cross)
+ *   X - oid cancelled
+ *   E - error, text is the description and oid is only set if has_oid
+ *   P - resting order oid in the book, qty is its open quantity
+ *
+ * symbol and text are views owned by the engine and are only valid for
+ * the duration of the EventSink::event() call.
+*/
+typedef struct Event
+{
+  char type;
+  char side;
+  bool has_oid;
+  unsigned short qty;
+  unsigned int oid;
+  px_t px;
+  std::string_view symbol;
+  std::string_view text;
+} event_t;
+
+/*
+ * Receiver for the events of SimpleCross::action
+*/
+class EventSink
+{
+  public:
+    virtual ~EventSink() {}
+    virtual void event(const event_t& ev) = 0;
+};
+
+//Longest F, X or P line, only E lines (which echo input) can be longer
+const std::size_t EVENT_MAX_LEN = 64;
+
+std::size_t format_event(const event_t& ev, char* buf, std::size_t len);
+std::string format_event(const event_t& ev);
+
+#endif
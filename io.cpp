@@ -0,0 +1,22 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include "io.h"
+
+void fail_errno(const std::string& what){
+  throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void write_all(int fd, const char* p, std::size_t n, const char* what){
+  while(n > 0){
+    ssize_t w = ::write(fd, p, n);
+    if(w < 0){
+      if(errno == EINTR)
+        continue;
+      fail_errno(what);
+    }
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+}
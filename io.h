@@ -0,0 +1,30 @@
+#ifndef IO_H
+#define IO_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Throw std::runtime_error for a failed system call
+ *
+ * The message is what followed by strerror(errno).
+ *
+ * @param what - the call and its target, e.g. "open " + path
+ * @throws std::runtime_error - always
+*/
+[[noreturn]] void fail_errno(const std::string& what);
+
+/*
+ * Write all of p to fd
+ *
+ * Short writes are continued and EINTR is retried.
+ *
+ * @param fd   - descriptor to write to
+ *        p    - bytes to write
+ *        n    - number of bytes
+ *        what - prefix of the error message
+ * @throws std::runtime_error - write(2) fails
+*/
+void write_all(int fd, const char* p, std::size_t n, const char* what);
+
+#endif
@@ -0,0 +1,236 @@
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io.h"
+#include "journal.h"
+#include "simple_cross.h"
+
+namespace {
+
+const char TIF_BIT = static_cast<char>(0x80);
+
+uint32_t record_check(const journal_record_t& rec){
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(&rec);
+  uint32_t h = 2166136261u;
+  for(std::size_t i = 0; i < offsetof(journal_record_t, check); ++i)
+    h = (h ^ p[i]) * 16777619u;
+  return h;
+}
+
+bool read_header(int fd){
+  uint32_t header[2];
+  return ::pread(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+    header[0] == Journal::MAGIC && header[1] == Journal::VERSION;
+}
+
+class NullSink : public EventSink
+{
+  public:
+    void event(const event_t&) override {}
+};
+
+}
+
+/*
+ * Open a journal for appending
+ *
+ * A new (or empty) file gets the journal header, an existing one must be
+ * a clean journal, i.e. recover() it first if the last run may have left
+ * a torn record behind.
+ *
+ * @param path   - the journal file
+ *        config - group commit policy and buffer size
+ * @throws std::runtime_error - the file is not a journal or can not be opened
+*/
+Journal::Journal(const char* path, const journal_config_t& config) :
+  config_m(config){
+  if(config_m.buffer < sizeof(journal_record_t))
+    config_m.buffer = sizeof(journal_record_t);
+  buf_m.reset(new char[config_m.buffer]);
+  fd_m = ::open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if(fd_m < 0)
+    fail_errno(std::string("open ") + path);
+  struct stat st;
+  if(::fstat(fd_m, &st) != 0){
+    ::close(fd_m);
+    fail_errno(std::string("stat ") + path);
+  }
+  std::size_t size = static_cast<std::size_t>(st.st_size);
+  if(size == 0){
+    uint32_t header[2] = {MAGIC, VERSION};
+    write_all(fd_m, reinterpret_cast<const char*>(header), sizeof(header), "journal write");
+    size = HEADER_SIZE;
+  }
+  else if(!read_header(fd_m) || (size - HEADER_SIZE) % sizeof(journal_record_t) != 0){
+    ::close(fd_m);
+    throw std::runtime_error(std::string("journal ") + path + " is damaged, recover it first");
+  }
+  appended_m = durable_m = (size - HEADER_SIZE) / sizeof(journal_record_t);
+}
+
+/*
+ * Sync whatever is pending and close the file
+*/
+Journal::~Journal(){
+  try {
+    commit();
+  }
+  catch(std::runtime_error&) {
+  }
+  ::close(fd_m);
+}
+
+/*
+ * Append an accepted request
+ *
+ * The record is copied into the buffer, the buffer only reaches the
+ * file when it is full or a group commit trigger fires.
+ *
+ * @param rq - the O, X, M or C request about to be applied
+ * @return none
+*/
+void Journal::append(const request_t& rq){
+  if(len_m + sizeof(journal_record_t) > config_m.buffer)
+    write_out();
+  journal_record_t rec;
+  std::memset(&rec, 0, sizeof(rec));
+  rec.symbol = rq.action == 'O' || rq.action == 'C' ? symbol_key(rq.symbol) : 0;
+  rec.px = rq.action == 'O' || rq.action == 'M' ? rq.px : 0;
+  rec.oid = rq.action != 'C' ? rq.oid : 0;
+  rec.qty = rq.action == 'O' || rq.action == 'M' ? rq.qty : 0;
+  rec.action = rq.action == 'O' && rq.tif == 'I' ? rq.action | TIF_BIT : rq.action;
+  rec.side = rq.action == 'O' || rq.action == 'C' ? rq.side : 0;
+  if(rq.action == 'O' && rq.tif == 'F')
+    rec.side |= TIF_BIT;
+  rec.seq = static_cast<uint32_t>(appended_m);
+  rec.check = record_check(rec);
+  std::memcpy(buf_m.get() + len_m, &rec, sizeof(rec));
+  len_m += sizeof(rec);
+  ++appended_m;
+
+  if(pending_m++ == 0 && config_m.sync_us > 0)
+    oldest_m = std::chrono::steady_clock::now();
+  if(config_m.sync_every > 0 && pending_m >= config_m.sync_every)
+    commit();
+  else
+    poll();
+}
+
+/*
+ * Commit the pending group if it has waited sync_us or longer
+*/
+void Journal::poll(){
+  if(pending_m == 0 || config_m.sync_us == 0)
+    return;
+  if(std::chrono::steady_clock::now() - oldest_m >= std::chrono::microseconds(config_m.sync_us))
+    commit();
+}
+
+/*
+ * Write and sync every appended record
+ *
+ * @throws std::runtime_error - write(2) or fdatasync(2) fails
+*/
+void Journal::commit(){
+  if(pending_m == 0 && len_m == 0)
+    return;
+  write_out();
+  while(::fdatasync(fd_m) != 0)
+    if(errno != EINTR)
+      fail_errno("journal fdatasync");
+  durable_m = appended_m;
+  pending_m = 0;
+  ++syncs_m;
+}
+
+void Journal::write_out(){
+  std::size_t len = len_m;
+  len_m = 0;
+  write_all(fd_m, buf_m.get(), len, "journal write");
+}
+
+/*
+ * Rebuild a book from its journal
+ *
+ * Every valid record is executed against scross (results discarded) in
+ * journal order. Recovery stops at the first short, out of sequence or
+ * corrupt record, which is what a crash in the middle of a write leaves
+ * behind, and the file is truncated after the last valid record so a
+ * Journal can append to it again. A missing file is an empty journal.
+ *
+ * Records before from are only validated, they are already reflected in
+ * a snapshot scross was loaded from (see SimpleCross::load_snapshot).
+ *
+ * scross must not have a journal attached, or the records would be
+ * written a second time.
+ *
+ * @param path   - the journal file
+ *        scross - an empty (or snapshot loaded) book to replay into
+ *        from   - index of the first record to apply
+ * @return records - number of requests applied
+ * @throws std::runtime_error - the file exists but is not a journal
+*/
+std::size_t recover(const char* path, SimpleCross& scross, uint64_t from){
+  int fd = ::open(path, O_RDWR);
+  if(fd < 0){
+    if(errno == ENOENT)
+      return 0;
+    fail_errno(std::string("open ") + path);
+  }
+  struct stat st;
+  if(::fstat(fd, &st) != 0){
+    ::close(fd);
+    fail_errno(std::string("stat ") + path);
+  }
+  if(st.st_size == 0){
+    ::close(fd);
+    return 0;
+  }
+  if(!read_header(fd)){
+    ::close(fd);
+    throw std::runtime_error(std::string("journal ") + path + " has no valid header");
+  }
+
+  NullSink sink;
+  std::unique_ptr<journal_record_t[]> recs(new journal_record_t[1024]);
+  std::size_t records = 0;
+  off_t off = Journal::HEADER_SIZE;
+  for(bool valid = true; valid;){
+    ssize_t n = ::pread(fd, recs.get(), 1024 * sizeof(journal_record_t), off);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      ::close(fd);
+      fail_errno(std::string("read ") + path);
+    }
+    std::size_t count = static_cast<std::size_t>(n) / sizeof(journal_record_t);
+    valid = count > 0;
+    for(std::size_t i = 0; i < count; ++i){
+      const journal_record_t& rec = recs[i];
+      char action = rec.action & ~TIF_BIT;
+      if(rec.check != record_check(rec) || rec.seq != static_cast<uint32_t>(records) ||
+         (action != 'O' && action != 'X' && action != 'M' && action != 'C')){
+        valid = false;
+        break;
+      }
+      char tif = action != 'O' ? 0 : rec.action & TIF_BIT ? 'I' : rec.side & TIF_BIT ? 'F' : 0;
+      request_t rq{action, rec.oid, key_symbol(rec.symbol),
+        static_cast<char>(rec.side & ~TIF_BIT), rec.qty, rec.px, 0, tif};
+      if(records >= from)
+        scross.execute(rq, sink);
+      ++records;
+      off += sizeof(journal_record_t);
+    }
+  }
+  if(off < st.st_size && ::ftruncate(fd, off) != 0){
+    ::close(fd);
+    fail_errno(std::string("truncate ") + path);
+  }
+  ::close(fd);
+  return records < from ? 0 : records - from;
+}
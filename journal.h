@@ -0,0 +1,103 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "request_parser.h"
+
+class SimpleCross;
+
+/*
+ * Journal record, one accepted O, X, M or C request
+ *
+ * Fixed 32 bytes so records never straddle a buffer boundary and a torn
+ * tail is detected by length alone. seq is the record's position in the
+ * journal (low 32 bits) and check an FNV-1a hash of the preceding 28
+ * bytes, so stale or half written records are rejected on recovery.
+ *
+ * The time in force of an O rides in the high bit of action (IOC) and of
+ * side (FOK), both ASCII letters, so records without one are exactly the
+ * records journals were written with before IOC and FOK existed.
+*/
+typedef struct JournalRecord
+{
+  uint64_t symbol;
+  int64_t px;
+  uint32_t oid;
+  uint16_t qty;
+  char action;
+  char side;
+  uint32_t seq;
+  uint32_t check;
+} journal_record_t;
+
+static_assert(sizeof(journal_record_t) == 32, "journal_record_t must stay 32 bytes");
+
+/*
+ * Group commit policy
+ *
+ * The buffer is synced once sync_every records are pending or the oldest
+ * pending record is sync_us microseconds old, whichever comes first. A
+ * zero disables that trigger, with both zero records are only synced by
+ * commit() (or when the journal is closed).
+*/
+typedef struct JournalConfig
+{
+  unsigned int sync_every = 64;
+  unsigned int sync_us = 1000;
+  std::size_t buffer = 1 << 16;
+} journal_config_t;
+
+/*
+ * Append-only write-ahead journal of accepted requests
+ *
+ * SimpleCross appends every O that passed the duplicate check, every X
+ * or M that found its order and every C, before applying it. Records
+ * are encoded into a preallocated buffer and reach the disk with one
+ * write(2) + fdatasync(2) per group, so the per action cost is a 32
+ * byte copy.
+ *
+ * Events of an action are reported before its group is synced: a request
+ * is durable once durable() has counted it. Triggers are only checked
+ * on append, an idle caller should poll() so a partial group does not
+ * wait for the next action.
+ *
+ * @throws std::runtime_error - the file can not be opened, written or synced
+*/
+class Journal
+{
+  private:
+    int fd_m;
+    journal_config_t config_m;
+    std::unique_ptr<char[]> buf_m;
+    std::size_t len_m = 0;
+    uint64_t appended_m;
+    uint64_t durable_m;
+    std::size_t pending_m = 0;
+    uint64_t syncs_m = 0;
+    std::chrono::steady_clock::time_point oldest_m;
+
+    void write_out();
+  public:
+    static const uint32_t MAGIC = 0x4a4e5853; //"SXNJ"
+    static const uint32_t VERSION = 1;
+    static const std::size_t HEADER_SIZE = 8;
+
+    explicit Journal(const char* path, const journal_config_t& config = journal_config_t());
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void append(const request_t& rq);
+    void poll();
+    void commit();
+    uint64_t appended() const { return appended_m; }
+    uint64_t durable() const { return durable_m; }
+    uint64_t syncs() const { return syncs_m; }
+};
+
+std::size_t recover(const char* path, SimpleCross& scross, uint64_t from = 0);
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef LADDER_H
+#define LADDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "pool.h"
+#include "price.h"
+
+/*
+ * Price level
+ *
+ * All resting orders at one price on one side of a symbol's book, kept as
+ * an intrusive FIFO list of order pool handles. Orders are added at the
+ * tail and filled from the head, which gives time priority within the level.
+ *
+ * open_qty and orders aggregate the level's resting orders and are kept
+ * up to date on every create, fill and cancel, so depth queries never
+ * walk the orders.
+*/
+typedef struct Level
+{
+  handle_t head;
+  handle_t tail;
+  uint32_t orders;
+  uint64_t open_qty;
+  px_t px;
+} level_t;
+
+/*
+ * One side of a symbol's book, levels ordered by price
+ *
+ * Levels are kept in a sparse std::map by default. A side given a price
+ * band (set_band) also keeps a dense ladder: an array of levels indexed
+ * by (px - low) / tick for every on-tick price in [low, high], plus a
+ * two-level occupancy bitmap (one bit per slot, one summary bit per
+ * non-zero leaf word), so the best level and the next level in either
+ * direction are found without a loop or tree walk: one count-trailing
+ * (or leading) zeros on the slot's leaf word, or else one on the summary
+ * word and one on the leaf word it points to. A band is capped at
+ * MAX_BAND_SLOTS (4096) slots so the single summary word covers it all.
+ * Prices outside the band or off its tick still go to the map, walks
+ * merge the two.
+ *
+ * A level_t* stays valid until the level is erased: map nodes never
+ * move and the dense array is allocated once per band. Map nodes come
+ * from the BlockPool given at construction, if any, so a level that is
+ * created and erased over and over doesn't call the system allocator.
+*/
+class Ladder
+{
+  private:
+    static const uint32_t NONE = UINT32_MAX;
+
+    typedef std::map<px_t, level_t, std::less<px_t>, PoolAllocator<std::pair<const px_t, level_t>>> sparse_t;
+
+    sparse_t sparse_m;
+    std::unique_ptr<level_t[]> slots_m;
+    std::vector<uint64_t> leaf_m;
+    uint64_t summary_m = 0;
+    px_t low_m = 0;
+    px_t high_m = -1;
+    px_t tick_m = 1;
+    uint32_t slot_count_m = 0;
+    std::size_t dense_m = 0;
+
+    uint32_t slot(px_t px) const {
+      if(px < low_m || px > high_m || (px - low_m) % tick_m != 0)
+        return NONE;
+      return static_cast<uint32_t>((px - low_m) / tick_m);
+    }
+
+    bool occupied(uint32_t s) const { return leaf_m[s >> 6] >> (s & 63) & 1; }
+
+    void occupy(uint32_t s){
+      uint32_t w = s >> 6;
+      if(leaf_m[w] == 0)
+        summary_m |= 1ull << w;
+      leaf_m[w] |= 1ull << (s & 63);
+    }
+
+    void vacate(uint32_t s){
+      uint32_t w = s >> 6;
+      leaf_m[w] &= ~(1ull << (s & 63));
+      if(leaf_m[w] == 0)
+        summary_m &= ~(1ull << w);
+    }
+
+    //First occupied slot >= s
+    uint32_t next_slot(uint32_t s) const {
+      if(s >= slot_count_m)
+        return NONE;
+      uint32_t w = s >> 6;
+      uint64_t bits = leaf_m[w] & (~0ull << (s & 63));
+      if(bits)
+        return w << 6 | __builtin_ctzll(bits);
+      uint64_t words = w == 63 ? 0 : summary_m & (~0ull << (w + 1));
+      if(!words)
+        return NONE;
+      w = __builtin_ctzll(words);
+      return w << 6 | __builtin_ctzll(leaf_m[w]);
+    }
+
+    //Last occupied slot <= s
+    uint32_t prev_slot(uint32_t s) const {
+      if(slot_count_m == 0)
+        return NONE;
+      if(s >= slot_count_m)
+        s = slot_count_m - 1;
+      uint32_t w = s >> 6;
+      uint64_t bits = leaf_m[w] & (~0ull >> (63 - (s & 63)));
+      if(bits)
+        return w << 6 | (63 - __builtin_clzll(bits));
+      uint64_t words = summary_m & ((1ull << w) - 1);
+      if(!words)
+        return NONE;
+      w = 63 - __builtin_clzll(words);
+      return w << 6 | (63 - __builtin_clzll(leaf_m[w]));
+    }
+
+    //First slot priced >= px / last slot priced <= px, occupied or not
+    uint32_t ceil_slot(px_t px) const {
+      if(px <= low_m)
+        return 0;
+      return px > high_m ? slot_count_m : static_cast<uint32_t>((px - low_m + tick_m - 1) / tick_m);
+    }
+
+    uint32_t floor_slot(px_t px) const {
+      if(px < low_m)
+        return NONE;
+      return px >= high_m ? slot_count_m - 1 : static_cast<uint32_t>((px - low_m) / tick_m);
+    }
+
+    template <typename Lv, typename L>
+    static Lv* find_best(L& ladder, bool highest){
+      uint32_t d = ladder.dense_m == 0 ? NONE : highest ? ladder.prev_slot(ladder.slot_count_m - 1) : ladder.next_slot(0);
+      if(ladder.sparse_m.empty())
+        return d == NONE ? nullptr : &ladder.slots_m[d];
+      Lv* s = highest ? &ladder.sparse_m.rbegin()->second : &ladder.sparse_m.begin()->second;
+      if(d == NONE || (highest ? s->px > ladder.slots_m[d].px : s->px < ladder.slots_m[d].px))
+        return s;
+      return &ladder.slots_m[d];
+    }
+
+    //A walk from INT64_MIN (INT64_MAX) starts at the first (past the last) map node, no search
+    template <typename L, typename F>
+    static void walk_up(L& ladder, px_t from, F f){
+      auto s = from == INT64_MIN ? ladder.sparse_m.begin() : ladder.sparse_m.lower_bound(from);
+      uint32_t d = ladder.next_slot(ladder.ceil_slot(from));
+      while(s != ladder.sparse_m.end() || d != NONE){
+        if(d == NONE || (s != ladder.sparse_m.end() && s->first < ladder.slots_m[d].px)){
+          if(!f(s->second))
+            return;
+          ++s;
+        }
+        else {
+          if(!f(ladder.slots_m[d]))
+            return;
+          d = ladder.next_slot(d + 1);
+        }
+      }
+    }
+
+    template <typename L, typename F>
+    static void walk_down(L& ladder, px_t from, F f){
+      auto s = from == INT64_MAX ? ladder.sparse_m.end() : ladder.sparse_m.upper_bound(from);
+      uint32_t d = ladder.slot_count_m == 0 ? NONE : ladder.floor_slot(from);
+      d = d == NONE ? NONE : ladder.prev_slot(d);
+      while(s != ladder.sparse_m.begin() || d != NONE){
+        if(d == NONE || (s != ladder.sparse_m.begin() && std::prev(s)->first > ladder.slots_m[d].px)){
+          if(!f((--s)->second))
+            return;
+        }
+        else {
+          if(!f(ladder.slots_m[d]))
+            return;
+          d = d == 0 ? NONE : ladder.prev_slot(d - 1);
+        }
+      }
+    }
+
+  public:
+    static const uint32_t MAX_BAND_SLOTS = 64 * 64;
+
+    //Map node of a level, a value initialized node_t for a dense level
+    typedef sparse_t::iterator node_t;
+
+    typedef struct Emplaced
+    {
+      level_t* level;
+      node_t node;
+      bool created;
+    } emplaced_t;
+
+    explicit Ladder(BlockPool* nodes = nullptr) : sparse_m(sparse_t::allocator_type(nodes)) {}
+    Ladder(Ladder&&) = default;
+    Ladder& operator=(Ladder&&) = default;
+
+    /*
+     * Give this side a dense band of (high - low) / tick + 1 slots
+     *
+     * Levels already held (in the map or an earlier band) move to the
+     * new layout, which invalidates every level_t* into this ladder.
+     * A zero tick drops the band and keeps every level in the map.
+    */
+    void set_band(px_t low, px_t high, px_t tick){
+      Ladder fresh(sparse_m.get_allocator().pool());
+      if(tick > 0){
+        fresh.low_m = low;
+        fresh.tick_m = tick;
+        fresh.slot_count_m = static_cast<uint32_t>((high - low) / tick + 1);
+        fresh.high_m = low + (fresh.slot_count_m - 1) * tick;
+        fresh.slots_m.reset(new level_t[fresh.slot_count_m]);
+        fresh.leaf_m.assign((fresh.slot_count_m + 63) / 64, 0);
+      }
+      walk_up(*this, INT64_MIN, [&fresh](const level_t& level){
+        *fresh.try_emplace(level.px).level = level;
+        return true;
+      });
+      *this = std::move(fresh);
+    }
+
+    std::size_t size() const { return sparse_m.size() + dense_m; }
+    bool empty() const { return size() == 0; }
+
+    /*
+     * Find the level at px, creating an empty one if there is none
+     *
+     * @return level, node, created - the level, its map node and whether
+     *                                it is new
+    */
+    emplaced_t try_emplace(px_t px){
+      uint32_t s = slot(px);
+      if(s != NONE){
+        level_t* level = &slots_m[s];
+        if(occupied(s))
+          return {level, node_t(), false};
+        occupy(s);
+        ++dense_m;
+        *level = level_t{NULL_HANDLE, NULL_HANDLE, 0, 0, px};
+        return {level, node_t(), true};
+      }
+      //Levels mostly arrive at the back in a bulk load, hint the end
+      auto hint = sparse_m.empty() || px > sparse_m.rbegin()->first ? sparse_m.end() : sparse_m.lower_bound(px);
+      if(hint != sparse_m.end() && hint->first == px)
+        return {&hint->second, hint, false};
+      auto it = sparse_m.emplace_hint(hint, px, level_t{NULL_HANDLE, NULL_HANDLE, 0, 0, px});
+      return {&it->second, it, true};
+    }
+
+    /*
+     * Map node of the level at px, for callers that hold on to levels
+     * across set_band
+    */
+    node_t node(px_t px){ return slot(px) == NONE ? sparse_m.find(px) : node_t(); }
+
+    /*
+     * Erase a level given its node from try_emplace (or node), O(1)
+    */
+    void erase(level_t* level, node_t node){
+      uint32_t s = slot(level->px);
+      if(s == NONE)
+        sparse_m.erase(node);
+      else {
+        vacate(s);
+        --dense_m;
+      }
+    }
+
+    void clear(){
+      sparse_m.clear();
+      std::fill(leaf_m.begin(), leaf_m.end(), 0);
+      summary_m = 0;
+      dense_m = 0;
+    }
+
+    /*
+     * Lowest (highest == false) or highest priced level, nullptr if empty
+    */
+    level_t* best(bool highest){ return find_best<level_t>(*this, highest); }
+    const level_t* best(bool highest) const { return find_best<const level_t>(*this, highest); }
+
+    /*
+     * Visit levels priced >= from in ascending order (up) or priced
+     * <= from in descending order (down) until f returns false
+    */
+    template <typename F>
+    void up(px_t from, F f){ walk_up(*this, from, f); }
+    template <typename F>
+    void up(px_t from, F f) const { walk_up(*this, from, f); }
+    template <typename F>
+    void down(px_t from, F f){ walk_down(*this, from, f); }
+    template <typename F>
+    void down(px_t from, F f) const { walk_down(*this, from, f); }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include "latency.h"
+
+unsigned LatencyHistogram::bucket(uint64_t ns){
+  if(ns < SUB)
+    return static_cast<unsigned>(ns);
+  unsigned msb = 63 - __builtin_clzll(ns);
+  if(msb >= MAX_BITS)
+    return BUCKETS - 1;
+  unsigned shift = msb - SUB_BITS;
+  return static_cast<unsigned>((shift + 1) * SUB + ((ns >> shift) - SUB));
+}
+
+/*
+ * Highest value that falls in bucket b
+*/
+uint64_t LatencyHistogram::bucket_value(unsigned b){
+  if(b < SUB)
+    return b;
+  unsigned shift = b / SUB - 1;
+  uint64_t mantissa = b % SUB + SUB;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns){
+  ++counts_m[bucket(ns)];
+  ++count_m;
+  if(ns > max_m)
+    max_m = ns;
+}
+
+/*
+ * Value below which p percent of the recorded latencies fall
+ *
+ * @param p  - percentile, 0 to 100
+ * @return ns - upper bound of the bucket holding that rank (capped at max)
+*/
+uint64_t LatencyHistogram::percentile(double p) const {
+  if(count_m == 0)
+    return 0;
+  uint64_t rank = static_cast<uint64_t>(p / 100.0 * count_m + 0.5);
+  if(rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for(unsigned b = 0; b < BUCKETS; ++b){
+    seen += counts_m[b];
+    if(seen >= rank)
+      return bucket_value(b) < max_m ? bucket_value(b) : max_m;
+  }
+  return max_m;
+}
+
+/*
+ * Print count, p50, p99, p99.9 and max (ns) for every action kind
+*/
+void LatencyStats::dump(std::ostream& out) const {
+  static const char* names[LAT_KINDS] = {"O rest", "O cross", "X", "C", "P", "M", "error"};
+  char line[128];
+  std::snprintf(line, sizeof(line), "%-8s %12s %10s %10s %10s %12s\n", "action", "count", "p50", "p99", "p99.9", "max(ns)");
+  out << line;
+  for(int k = 0; k < LAT_KINDS; ++k){
+    const LatencyHistogram& h = hist_m[k];
+    std::snprintf(line, sizeof(line), "%-8s %12llu %10llu %10llu %10llu %12llu\n", names[k],
+      static_cast<unsigned long long>(h.count()),
+      static_cast<unsigned long long>(h.percentile(50)),
+      static_cast<unsigned long long>(h.percentile(99)),
+      static_cast<unsigned long long>(h.percentile(99.9)),
+      static_cast<unsigned long long>(h.max()));
+    out << line;
+  }
+}
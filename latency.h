@@ -0,0 +1,101 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Per action latency histograms
+ *
+ * Only compiled in when SIMPLE_CROSS_LATENCY is defined (make LATENCY=1).
+ * Otherwise LATENCY_SCOPE/LATENCY_KIND expand to nothing and SimpleCross
+ * carries no timing code at all.
+*/
+typedef enum LatencyKind
+{
+  LAT_REST,        //O that rests without crossing
+  LAT_CROSS,       //O that crosses (fully or partially)
+  LAT_CANCEL,      //X
+  LAT_MASS_CANCEL, //C
+  LAT_PRINT,       //P
+  LAT_MODIFY,      //M
+  LAT_ERROR,       //any request answered with E
+  LAT_KINDS
+} latency_kind_t;
+
+/*
+ * Log-bucketed latency histogram
+ *
+ * HDR style: values below 2^SUB_BITS ns get an exact bucket, above that
+ * every power of two is split into 2^SUB_BITS linear sub-buckets, so any
+ * recorded value is reported within ~3%. Recording is a count-leading-
+ * zeros and an increment, the histogram is a fixed array.
+*/
+class LatencyHistogram
+{
+  private:
+    static const unsigned SUB_BITS = 5;
+    static const uint64_t SUB = 1 << SUB_BITS;
+    static const unsigned MAX_BITS = 40;
+    static const unsigned BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB;
+
+    uint64_t counts_m[BUCKETS] = {};
+    uint64_t count_m = 0;
+    uint64_t max_m = 0;
+
+    static unsigned bucket(uint64_t ns);
+    static uint64_t bucket_value(unsigned b);
+
+  public:
+    void record(uint64_t ns);
+    uint64_t count() const { return count_m; }
+    uint64_t max() const { return max_m; }
+    uint64_t percentile(double p) const;
+};
+
+class LatencyStats
+{
+  private:
+    LatencyHistogram hist_m[LAT_KINDS];
+  public:
+    //Kind of the action being timed, set by LATENCY_KIND
+    latency_kind_t current = LAT_ERROR;
+
+
+    void record(latency_kind_t kind, uint64_t ns){ hist_m[kind].record(ns); }
+    const LatencyHistogram& operator[](latency_kind_t kind) const { return hist_m[kind]; }
+    void dump(std::ostream& out) const;
+};
+
+/*
+ * Times its scope into a LatencyStats under the kind set before it ends
+ *
+ * The kind lives in the stats rather than the timer, so a helper called
+ * inside the scope can set it. A scope that sets no kind is an error.
+*/
+class LatencyTimer
+{
+  private:
+    typedef std::chrono::steady_clock clock;
+    LatencyStats& stats_m;
+    clock::time_point start_m;
+  public:
+    explicit LatencyTimer(LatencyStats& stats) : stats_m(stats), start_m(clock::now()) {
+      stats_m.current = LAT_ERROR;
+    }
+    ~LatencyTimer(){
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_m).count();
+      stats_m.record(stats_m.current, static_cast<uint64_t>(ns));
+    }
+};
+
+#ifdef SIMPLE_CROSS_LATENCY
+#define LATENCY_SCOPE(stats) LatencyTimer latency_timer_(stats)
+#define LATENCY_KIND(stats, k) ((stats).current = (k))
+#else
+#define LATENCY_SCOPE(stats)
+#define LATENCY_KIND(stats, k) ((void)0)
+#endif
+
+#endif
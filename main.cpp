@@ -1,26 +1,329 @@
 // Stub implementation and example driver for SimpleCross.
 // Your crossing logic should be accesible from the SimpleCross class.
 // Other than the signature of SimpleCross::action() you are free to modify as needed.
+//
+// The driver runs as a two stage pipeline: this thread reads and parses
+// actions.txt, a matcher thread executes the requests against the book
+// and the resulting events are formatted and written back on this thread.
+// The stages are connected by SPSC rings so neither waits on the other
+// unless a ring is empty or full.
+//
+// "main --replay FILE" instead memory maps FILE and replays it on a single
+// thread straight into a large buffered writer, for bulk captures where
+// iostreams would dominate.
+//
+// "--journal FILE" rebuilds the book from FILE before the first action
+// and then appends every accepted O, X, M and C to it (see journal.h).
+// "--snapshot FILE" loads the book from FILE first, if it exists, so only
+// the journal records after it are replayed, and saves the book back to
+// FILE at exit.
+//
+// "--band SYMBOL:LOW:HIGH:TICK" gives SYMBOL a dense price ladder over
+// [LOW, HIGH] in steps of TICK (see SimpleCross::set_price_band), once
+// per symbol. It changes how levels are stored, never the output.
+//
+// Built with make LATENCY=1 the per action latency percentiles are
+// printed to stderr at exit.
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "replay.h"
 #include "simple_cross.h"
+#include "spsc_ring.h"
 
+namespace {
+
+const std::size_t RING_SIZE = 4096;
+const std::size_t BATCH = 256;
+
+//Parsed line handed to the matcher, rq.action is 'E' for a malformed
+//line (error holds the result text after "E ") and 0 for end of input
+typedef struct Parsed
+{
+  request_t rq;
+  char symbol[MAX_SYMBOL_LEN];
+  std::string error;
+} parsed_t;
+
+//Event handed back from the matcher, ev.type 0 marks end of output
+typedef struct OutEvent
+{
+  event_t ev;
+  char symbol[MAX_SYMBOL_LEN];
+  std::string text;
+} out_event_t;
+
+/*
+ * Apply a --band SYMBOL:LOW:HIGH:TICK argument
+ *
+ * @return bool - false if spec is malformed or not a valid band
+*/
+bool apply_band(SimpleCross& scross, std::string_view spec){
+  std::string_view part[4];
+  for(int i = 0; i < 4; ++i){
+    std::size_t end = i < 3 ? spec.find(':') : spec.size();
+    if(end == std::string_view::npos)
+      return false;
+    part[i] = spec.substr(0, end);
+    spec.remove_prefix(i < 3 ? end + 1 : end);
+  }
+  px_t low, high, tick;
+  if(part[0].empty() || !parse_price(part[1], low) || !parse_price(part[2], high) || !parse_price(part[3], tick))
+    return false;
+  try {
+    scross.set_price_band(part[0], low, high, tick);
+  }
+  catch (std::invalid_argument&) {
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+void push_all(SpscRing<T>& ring, T* items, std::size_t n){
+  while(n > 0){
+    std::size_t pushed = ring.push(items, n);
+    items += pushed;
+    n -= pushed;
+    if(n > 0)
+      std::this_thread::yield();
+  }
+}
+
+/*
+ * EventSink that copies events into ring records
+ *
+ * Symbol and text views are only valid during the event() call so the
+ * bytes are copied into the record.
+*/
+class RingSink : public EventSink
+{
+  private:
+    std::vector<out_event_t>& batch_m;
+  public:
+    explicit RingSink(std::vector<out_event_t>& batch) : batch_m(batch) {}
+    void event(const event_t& ev) override {
+      batch_m.emplace_back();
+      out_event_t& out = batch_m.back();
+      out.ev = ev;
+      std::copy(ev.symbol.begin(), ev.symbol.end(), out.symbol);
+      if(ev.type == 'E')
+        out.text.assign(ev.text.data(), ev.text.size());
+    }
+};
+
+/*
+ * Matcher thread
+ *
+ * A journal that fails to write or sync throws out of execute() or
+ * poll(), the error is kept in error and the events matched so far are
+ * handed back followed by the end of output marker, the reader stops
+ * at that marker.
+*/
+void match(SpscRing<parsed_t>& in, SpscRing<out_event_t>& out, SimpleCross& scross, Journal* journal, std::string& error){
+  std::vector<parsed_t> batch(BATCH);
+  std::vector<out_event_t> events;
+  RingSink sink(events);
+  try {
+    for(;;){
+      std::size_t n = in.pop(batch.data(), batch.size());
+      if(n == 0){
+        //Idle, don't leave a partial group waiting for the next action
+        if(journal)
+          journal->poll();
+        std::this_thread::yield();
+        continue;
+      }
+      events.clear();
+      for(std::size_t i = 0; i < n; ++i){
+        parsed_t& p = batch[i];
+        if(p.rq.action == 0){
+#ifdef SIMPLE_CROSS_LATENCY
+          scross.latency().dump(std::cerr);
+#endif
+          events.emplace_back();
+          events.back().ev.type = 0;
+          push_all(out, events.data(), events.size());
+          return;
+        }
+        if(p.rq.action == 'E'){
+          scross.reject(p.error, sink);
+          continue;
+        }
+        p.rq.symbol = std::string_view(p.symbol, p.rq.symbol.size());
+        scross.execute(p.rq, sink);
+      }
+      push_all(out, events.data(), events.size());
+    }
+  }
+  catch(std::runtime_error& e) {
+    error = e.what();
+    events.emplace_back();
+    events.back().ev.type = 0;
+    push_all(out, events.data(), events.size());
+  }
+}
+
+}
 
 int main(int argc, char **argv)
 {
+    const char* replay_path = nullptr;
+    const char* journal_path = nullptr;
+    const char* snapshot_path = nullptr;
+    std::vector<std::string_view> bands;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--replay" && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (arg == "--journal" && i + 1 < argc)
+            journal_path = argv[++i];
+        else if (arg == "--snapshot" && i + 1 < argc)
+            snapshot_path = argv[++i];
+        else if (arg == "--band" && i + 1 < argc)
+            bands.push_back(argv[++i]);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--replay FILE] [--journal FILE] [--snapshot FILE]"
+                      << " [--band SYMBOL:LOW:HIGH:TICK ...]" << std::endl;
+            return 1;
+        }
+    }
+
+    BufferedWriter writer(STDOUT_FILENO);
     SimpleCross scross;
+    for (std::string_view band : bands)
+    {
+        if (!apply_band(scross, band))
+        {
+            std::cerr << "invalid price band " << band << std::endl;
+            return 1;
+        }
+    }
+    std::unique_ptr<Journal> journal;
+    try {
+        uint64_t journal_seq = 0;
+        if (snapshot_path && ::access(snapshot_path, F_OK) == 0)
+            journal_seq = scross.load_snapshot(snapshot_path);
+        if (journal_path)
+        {
+            recover(journal_path, scross, journal_seq);
+            journal.reset(new Journal(journal_path));
+            scross.set_journal(journal.get());
+        }
+    }
+    catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    //Snapshot the book on the way out so the next start skips the journal
+    auto save = [&](){
+        if (!snapshot_path)
+            return 0;
+        try {
+            scross.save_snapshot(snapshot_path);
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    };
+
+    if (replay_path)
+    {
+        try {
+            replay(replay_path, scross, writer);
+        }
+        catch (std::runtime_error& e) {
+            writer.flush();
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+#ifdef SIMPLE_CROSS_LATENCY
+        writer.flush();
+        scross.latency().dump(std::cerr);
+#endif
+        return save();
+    }
+
+    SpscRing<parsed_t> requests(RING_SIZE);
+    SpscRing<out_event_t> events(RING_SIZE);
+    std::string match_error;
+    std::thread matcher(match, std::ref(requests), std::ref(events), std::ref(scross), journal.get(), std::ref(match_error));
+
     std::string line;
     std::ifstream actions("actions.txt", std::ios::in);
-    while (std::getline(actions, line))
+    std::vector<parsed_t> batch;
+    std::vector<out_event_t> out(BATCH);
+    bool done = false;
+    auto drain = [&](){
+        std::size_t n = events.pop(out.data(), out.size());
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            event_t& ev = out[i].ev;
+            if (ev.type == 0)
+            {
+                done = true;
+                break;
+            }
+            ev.symbol = std::string_view(out[i].symbol, ev.symbol.size());
+            ev.text = ev.type == 'E' ? std::string_view(out[i].text) : ev.text;
+            writer.write_event(ev);
+        }
+        return n;
+    };
+    //done is also set early if the matcher stops on a journal error
+    bool more = true;
+    while (more && !done)
     {
-        results_t results = scross.action(line);
-        for (results_t::const_iterator it=results.begin(); it!=results.end(); ++it)
+        batch.clear();
+        while (batch.size() < BATCH && (more = static_cast<bool>(std::getline(actions, line))))
+        {
+            batch.emplace_back();
+            parsed_t& p = batch.back();
+            parse_result_t res = try_parse_request(line);
+            p.rq = res.rq;
+            if (res.ok())
+                std::copy(p.rq.symbol.begin(), p.rq.symbol.end(), p.symbol);
+            else
+            {
+                p.rq.action = 'E';
+                res.append_error(p.error);
+            }
+        }
+        if (!more)
+        {
+            batch.emplace_back();
+            batch.back().rq.action = 0;
+        }
+        //Keep draining while the request ring is full, the matcher may
+        //itself be waiting for room in the event ring
+        parsed_t* next = batch.data();
+        for (std::size_t n = batch.size(); n > 0 && !done;)
         {
-            std::cout << *it << std::endl;
+            std::size_t pushed = requests.push(next, n);
+            next += pushed;
+            n -= pushed;
+            if (drain() == 0 && n > 0)
+                std::this_thread::yield();
         }
     }
-    return 0;
+    while (!done)
+        if (drain() == 0)
+            std::this_thread::yield();
+    matcher.join();
+    if (!match_error.empty())
+    {
+        writer.flush();
+        std::cerr << match_error << std::endl;
+        return 1;
+    }
+    return save();
 }
-
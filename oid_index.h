@@ -0,0 +1,187 @@
+#ifndef OID_INDEX_H
+#define OID_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "pool.h"
+
+/*
+ * Live order index, OID -> order pool handle
+ *
+ * Flat open-addressing table with linear probing. Slots are 8 bytes so a
+ * probe sequence usually stays within one cache line. Erase uses backward
+ * shift deletion instead of tombstones so probe lengths do not degrade
+ * over a long session of inserts and erases. The table doubles once it is
+ * half full and never shrinks, so memory is bounded by the peak number of
+ * live orders.
+*/
+class OidIndex
+{
+  private:
+    typedef struct Slot
+    {
+      uint32_t oid;
+      handle_t h;
+    } slot_t;
+
+    std::vector<slot_t> slots_m;
+    uint32_t mask_m;
+    uint32_t shift_m;
+    std::size_t size_m = 0;
+
+    uint32_t home(uint32_t oid) const {
+      return static_cast<uint32_t>((oid * 0x9E3779B97F4A7C15ull) >> shift_m) & mask_m;
+    }
+
+    void rehash(std::size_t capacity){
+      std::vector<slot_t> old(capacity, slot_t{0, NULL_HANDLE});
+      old.swap(slots_m);
+      mask_m = static_cast<uint32_t>(capacity - 1);
+      shift_m = 64;
+      for(std::size_t c = capacity; c > 1; c >>= 1)
+        --shift_m;
+      for(const slot_t& s : old){
+        if(s.h == NULL_HANDLE)
+          continue;
+        uint32_t i = home(s.oid);
+        while(slots_m[i].h != NULL_HANDLE)
+          i = (i + 1) & mask_m;
+        slots_m[i] = s;
+      }
+    }
+
+  public:
+    explicit OidIndex(std::size_t capacity = 1024){
+      std::size_t c = 16;
+      while(c < capacity)
+        c <<= 1;
+      rehash(c);
+    }
+
+    std::size_t size() const { return size_m; }
+
+    /*
+     * Size the table for n entries up front, e.g. before a bulk load
+    */
+    void reserve(std::size_t n){
+      std::size_t c = slots_m.size();
+      while(c < n * 2)
+        c <<= 1;
+      if(c != slots_m.size())
+        rehash(c);
+    }
+
+    /*
+     * Drop every entry, one pass over the slots instead of n erases
+    */
+    void clear(){
+      for(slot_t& s : slots_m)
+        s.h = NULL_HANDLE;
+      size_m = 0;
+    }
+
+    handle_t find(uint32_t oid) const {
+      for(uint32_t i = home(oid);; i = (i + 1) & mask_m){
+        const slot_t& s = slots_m[i];
+        if(s.h == NULL_HANDLE || s.oid == oid)
+          return s.h;
+      }
+    }
+
+    void insert(uint32_t oid, handle_t h){
+      if((size_m + 1) * 2 > slots_m.size())
+        rehash(slots_m.size() * 2);
+      uint32_t i = home(oid);
+      while(slots_m[i].h != NULL_HANDLE && slots_m[i].oid != oid)
+        i = (i + 1) & mask_m;
+      if(slots_m[i].h == NULL_HANDLE)
+        ++size_m;
+      slots_m[i] = slot_t{oid, h};
+    }
+
+    void erase(uint32_t oid){
+      uint32_t i = home(oid);
+      while(slots_m[i].oid != oid || slots_m[i].h == NULL_HANDLE){
+        if(slots_m[i].h == NULL_HANDLE)
+          return;
+        i = (i + 1) & mask_m;
+      }
+      //Shift back any entry whose probe sequence passed through the hole
+      for(uint32_t j = i;;){
+        j = (j + 1) & mask_m;
+        if(slots_m[j].h == NULL_HANDLE)
+          break;
+        uint32_t k = home(slots_m[j].oid);
+        if(((j - k) & mask_m) < ((j - i) & mask_m))
+          continue;
+        slots_m[i] = slots_m[j];
+        i = j;
+      }
+      slots_m[i].h = NULL_HANDLE;
+      --size_m;
+    }
+};
+
+/*
+ * Set of every OID ever accepted
+ *
+ * Roaring-style split of the 32-bit OID space into 65536 chunks keyed by
+ * the high 16 bits. A chunk is an 8KB bitmap allocated the first time an
+ * OID in its range is used, so a session of densely allocated OIDs costs
+ * about one bit per OID and the worst case is bounded at 512MB no matter
+ * how many orders are entered.
+*/
+class OidSet
+{
+  public:
+    static const uint32_t CHUNK_BITS = 16;
+    static const uint32_t CHUNKS = 1u << (32 - CHUNK_BITS);
+    static const uint32_t CHUNK_WORDS = (1u << CHUNK_BITS) / 64;
+
+  private:
+    std::vector<std::unique_ptr<uint64_t[]>> chunks_m;
+    std::size_t size_m = 0;
+
+  public:
+    OidSet() : chunks_m(CHUNKS) {}
+
+    std::size_t size() const { return size_m; }
+
+    /*
+     * Raw bitmap of chunk i (OIDs i << CHUNK_BITS and up), nullptr if unused
+    */
+    const uint64_t* chunk(uint32_t i) const { return chunks_m[i].get(); }
+
+    /*
+     * Replace chunk i with CHUNK_WORDS words of bitmap
+    */
+    void load_chunk(uint32_t i, const uint64_t* words){
+      auto& chunk = chunks_m[i];
+      if(chunk)
+        for(uint32_t w = 0; w < CHUNK_WORDS; ++w)
+          size_m -= __builtin_popcountll(chunk[w]);
+      else
+        chunk.reset(new uint64_t[CHUNK_WORDS]);
+      for(uint32_t w = 0; w < CHUNK_WORDS; ++w)
+        size_m += __builtin_popcountll(chunk[w] = words[w]);
+    }
+
+    bool contains(uint32_t oid) const {
+      const uint64_t* chunk = chunks_m[oid >> CHUNK_BITS].get();
+      uint32_t bit = oid & ((1u << CHUNK_BITS) - 1);
+      return chunk && (chunk[bit >> 6] >> (bit & 63) & 1);
+    }
+
+    void insert(uint32_t oid){
+      auto& chunk = chunks_m[oid >> CHUNK_BITS];
+      if(!chunk)
+        chunk.reset(new uint64_t[CHUNK_WORDS]());
+      uint32_t bit = oid & ((1u << CHUNK_BITS) - 1);
+      uint64_t mask = uint64_t(1) << (bit & 63);
+      size_m += !(chunk[bit >> 6] & mask);
+      chunk[bit >> 6] |= mask;
+    }
+};
+
+#endif
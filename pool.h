@@ -0,0 +1,208 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+typedef uint32_t handle_t;
+
+const handle_t NULL_HANDLE = UINT32_MAX;
+
+/*
+ * Allocation counters for a Pool
+ *
+ * allocs/frees count slots handed out and returned, slabs counts the calls
+ * made to the system allocator. Once the pool has grown to the working set
+ * slabs stops moving, i.e. the steady state makes no malloc calls.
+*/
+typedef struct PoolStats
+{
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t slabs;
+  uint64_t live;
+} pool_stats_t;
+
+/*
+ * Recycling slab pool addressed by 32-bit handles
+ *
+ * Slots are carved out of fixed size slabs which are never moved or
+ * released, so a handle (and a reference to its slot) stays valid until
+ * the slot is freed. Freed slots are threaded onto a free list through
+ * Hot::next and reused before a new slab is allocated.
+ *
+ * Each slot is split in two: the Hot records of a slab are contiguous
+ * and the Cold records live in a parallel array, so walking hot records
+ * never pulls cold fields into cache.
+ *
+ * Hot must have a handle_t member named next.
+*/
+template <typename Hot, typename Cold>
+class Pool
+{
+  private:
+    static const unsigned SLAB_BITS = 12;
+    static const handle_t SLAB_SIZE = 1 << SLAB_BITS;
+    static const handle_t SLAB_MASK = SLAB_SIZE - 1;
+
+    typedef struct Slab
+    {
+      Hot hot[SLAB_SIZE];
+      Cold cold[SLAB_SIZE];
+    } slab_t;
+
+    std::vector<std::unique_ptr<slab_t>> slabs_m;
+    handle_t free_m = NULL_HANDLE;
+    handle_t size_m = 0;
+    pool_stats_t stats_m = {0, 0, 0, 0};
+
+  public:
+    Hot& operator[](handle_t h){ return slabs_m[h >> SLAB_BITS]->hot[h & SLAB_MASK]; }
+    const Hot& operator[](handle_t h) const { return slabs_m[h >> SLAB_BITS]->hot[h & SLAB_MASK]; }
+    Cold& cold(handle_t h){ return slabs_m[h >> SLAB_BITS]->cold[h & SLAB_MASK]; }
+    const Cold& cold(handle_t h) const { return slabs_m[h >> SLAB_BITS]->cold[h & SLAB_MASK]; }
+
+    handle_t alloc(){
+      handle_t h = free_m;
+      if(h != NULL_HANDLE)
+        free_m = (*this)[h].next;
+      else {
+        if((size_m & SLAB_MASK) == 0){
+          slabs_m.emplace_back(new slab_t);
+          ++stats_m.slabs;
+        }
+        h = size_m++;
+      }
+      ++stats_m.allocs;
+      ++stats_m.live;
+      return h;
+    }
+
+    void free(handle_t h){
+      (*this)[h].next = free_m;
+      free_m = h;
+      ++stats_m.frees;
+      --stats_m.live;
+    }
+
+    const pool_stats_t& stats() const { return stats_m; }
+};
+
+/*
+ * Recycling pool of fixed size blocks for node based containers
+ *
+ * The block size is taken from the first allocation, a std::map only
+ * ever allocates one node at a time so every later request has the same
+ * size. Blocks are carved out of slabs of SLAB_BLOCKS and recycled
+ * through a free list threaded through the freed blocks themselves,
+ * slabs are only released with the pool. A request of any other size
+ * goes to the system allocator.
+*/
+class BlockPool
+{
+  private:
+    static const std::size_t SLAB_BLOCKS = 256;
+
+    std::vector<std::unique_ptr<char[]>> slabs_m;
+    std::size_t block_m = 0;
+    void* free_m = nullptr;
+    std::size_t carved_m = SLAB_BLOCKS;
+    pool_stats_t stats_m = {0, 0, 0, 0};
+
+    static std::size_t block_size(std::size_t bytes){
+      const std::size_t align = alignof(std::max_align_t);
+      return (std::max(bytes, sizeof(void*)) + align - 1) & ~(align - 1);
+    }
+
+  public:
+    BlockPool() = default;
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* alloc(std::size_t bytes){
+      if(block_m == 0)
+        block_m = block_size(bytes);
+      if(block_size(bytes) != block_m)
+        return ::operator new(bytes);
+      void* p = free_m;
+      if(p)
+        free_m = *static_cast<void**>(p);
+      else {
+        if(carved_m == SLAB_BLOCKS){
+          slabs_m.emplace_back(new char[SLAB_BLOCKS * block_m]);
+          carved_m = 0;
+          ++stats_m.slabs;
+        }
+        p = slabs_m.back().get() + carved_m++ * block_m;
+      }
+      ++stats_m.allocs;
+      ++stats_m.live;
+      return p;
+    }
+
+    void free(void* p, std::size_t bytes){
+      if(block_size(bytes) != block_m){
+        ::operator delete(p);
+        return;
+      }
+      *static_cast<void**>(p) = free_m;
+      free_m = p;
+      ++stats_m.frees;
+      --stats_m.live;
+    }
+
+    const pool_stats_t& stats() const { return stats_m; }
+};
+
+/*
+ * Allocator handing out BlockPool blocks
+ *
+ * Without a pool (default constructed) it falls back to the system
+ * allocator. Copies share the pool, so the pool must outlive every
+ * container using it.
+*/
+template <typename T>
+class PoolAllocator
+{
+  private:
+    BlockPool* pool_m;
+
+    template <typename U>
+    friend class PoolAllocator;
+
+  public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    explicit PoolAllocator(BlockPool* pool = nullptr) : pool_m(pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool_m(other.pool_m) {}
+
+    BlockPool* pool() const { return pool_m; }
+
+    T* allocate(std::size_t n){
+      if(!pool_m)
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      return static_cast<T*>(pool_m->alloc(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n){
+      if(!pool_m)
+        ::operator delete(p);
+      else
+        pool_m->free(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool_m == other.pool_m; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool_m != other.pool_m; }
+};
+
+#endif
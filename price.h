@@ -0,0 +1,49 @@
+#ifndef PRICE_H
+#define PRICE_H
+
+#include <charconv>
+#include <cstdint>
+
+/*
+ * Fixed-point price
+ *
+ * Prices are carried as a signed count of ticks of 1/PX_SCALE so that
+ * comparisons are exact integer compares. PX_SCALE matches the 7.5 price
+ * format, every price that can be entered is representable.
+*/
+typedef int64_t px_t;
+
+const px_t PX_SCALE = 100000;
+const int PX_DECIMALS = 5;
+
+//Longest format_px() output: sign, 19 digit px_t, decimal point
+const std::size_t PX_MAX_CHARS = 21;
+
+inline double px_to_double(px_t px){
+  return static_cast<double>(px) / PX_SCALE;
+}
+
+/*
+ * Write a price in 7.5 format (e.g. "100.00000")
+ *
+ * Pure integer arithmetic on the ticks, no locale or floating point.
+ *
+ * @param px   - the price to format
+ *        out  - buffer of at least PX_MAX_CHARS characters
+ * @return end - one past the last character written
+*/
+inline char* format_px(px_t px, char* out){
+  uint64_t ticks = static_cast<uint64_t>(px);
+  if(px < 0){
+    *out++ = '-';
+    ticks = 0 - ticks;
+  }
+  out = std::to_chars(out, out + PX_MAX_CHARS, ticks / PX_SCALE).ptr;
+  *out++ = '.';
+  uint64_t frac = ticks % PX_SCALE;
+  for(int i = PX_DECIMALS - 1; i >= 0; --i, frac /= 10)
+    out[i] = static_cast<char>('0' + frac % 10);
+  return out + PX_DECIMALS;
+}
+
+#endif
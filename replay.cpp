@@ -0,0 +1,121 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "io.h"
+#include "replay.h"
+
+MappedFile::MappedFile(const char* path){
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0)
+    fail_errno(std::string("open ") + path);
+  struct stat st;
+  if(::fstat(fd, &st) != 0){
+    ::close(fd);
+    fail_errno(std::string("stat ") + path);
+  }
+  size_m = static_cast<std::size_t>(st.st_size);
+  if(size_m > 0){
+    void* p = ::mmap(nullptr, size_m, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED){
+      ::close(fd);
+      fail_errno(std::string("mmap ") + path);
+    }
+    ::madvise(p, size_m, MADV_SEQUENTIAL);
+    data_m = static_cast<const char*>(p);
+  }
+  ::close(fd);
+}
+
+MappedFile::~MappedFile(){
+  if(data_m)
+    ::munmap(const_cast<char*>(data_m), size_m);
+}
+
+BufferedWriter::BufferedWriter(int fd, std::size_t size) :
+  fd_m(fd), buf_m(new char[size]), size_m(size) {}
+
+BufferedWriter::~BufferedWriter(){
+  try {
+    flush();
+  }
+  catch(std::runtime_error&) {
+  }
+}
+
+void BufferedWriter::flush(){
+  std::size_t len = len_m;
+  len_m = 0;
+  write_all(fd_m, buf_m.get(), len, "write");
+}
+
+void BufferedWriter::write(const char* data, std::size_t n){
+  if(len_m + n > size_m)
+    flush();
+  if(n > size_m){
+    while(n > 0){
+      std::size_t chunk = n < size_m ? n : size_m;
+      std::memcpy(buf_m.get(), data, chunk);
+      len_m = chunk;
+      flush();
+      data += chunk;
+      n -= chunk;
+    }
+    return;
+  }
+  std::memcpy(buf_m.get() + len_m, data, n);
+  len_m += n;
+}
+
+/*
+ * Format an event straight into the buffer
+ *
+ * F, X and P lines (and short E lines) are formatted in place, only an
+ * E line longer than EVENT_MAX_LEN goes through a temporary string.
+*/
+void BufferedWriter::write_event(const event_t& ev){
+  if(len_m + EVENT_MAX_LEN + 1 > size_m)
+    flush();
+  std::size_t n = format_event(ev, buf_m.get() + len_m, EVENT_MAX_LEN);
+  if(n > EVENT_MAX_LEN){
+    std::string line = format_event(ev);
+    line += '\n';
+    write(line.data(), line.size());
+    return;
+  }
+  len_m += n;
+  buf_m[len_m++] = '\n';
+}
+
+/*
+ * Replay an action file
+ *
+ * The file is memory mapped and every line is handed to
+ * SimpleCross::action as a string_view into the mapping, results are
+ * written through out. Lines are split on '\n' exactly like
+ * std::getline, so the output matches the iostream driver.
+ *
+ * @param path  - the action file
+ *        scross - the book to replay into
+ *        out    - destination for the RESULT lines
+ * @return lines - number of lines replayed
+*/
+std::size_t replay(const char* path, SimpleCross& scross, BufferedWriter& out){
+  MappedFile file(path);
+  WriterSink sink(out);
+  std::string_view data = file.view();
+  std::size_t lines = 0;
+  while(!data.empty()){
+    std::size_t eol = data.find('\n');
+    std::string_view line = data.substr(0, eol);
+    scross.action(line, sink);
+    ++lines;
+    if(eol == std::string_view::npos)
+      break;
+    data.remove_prefix(eol + 1);
+  }
+  return lines;
+}
@@ -0,0 +1,70 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include "simple_cross.h"
+
+/*
+ * Read-only memory mapping of a whole file
+ *
+ * @throws std::runtime_error - the file can not be opened or mapped
+*/
+class MappedFile
+{
+  private:
+    const char* data_m = nullptr;
+    std::size_t size_m = 0;
+  public:
+    explicit MappedFile(const char* path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return std::string_view(data_m, size_m); }
+};
+
+/*
+ * Large buffered writer over a file descriptor
+ *
+ * Output is collected in a single buffer and handed to write(2) only
+ * when it fills up (or on flush), there is no per-line flushing.
+ *
+ * @throws std::runtime_error - write(2) fails
+*/
+class BufferedWriter
+{
+  private:
+    int fd_m;
+    std::unique_ptr<char[]> buf_m;
+    std::size_t size_m;
+    std::size_t len_m = 0;
+  public:
+    static const std::size_t DEFAULT_SIZE = 1 << 20;
+
+    explicit BufferedWriter(int fd, std::size_t size = DEFAULT_SIZE);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void write(const char* data, std::size_t n);
+    void write_event(const event_t& ev);
+    void flush();
+};
+
+/*
+ * EventSink writing every event as a RESULT line through a BufferedWriter
+*/
+class WriterSink : public EventSink
+{
+  private:
+    BufferedWriter& out_m;
+  public:
+    explicit WriterSink(BufferedWriter& out) : out_m(out) {}
+    void event(const event_t& ev) override { out_m.write_event(ev); }
+};
+
+std::size_t replay(const char* path, SimpleCross& scross, BufferedWriter& out);
+
+#endif
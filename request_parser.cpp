@@ -0,0 +1,297 @@
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include "request_parser.h"
+
+namespace {
+
+const std::size_t MAX_TOKENS = 7;
+
+/*
+ * Whitespace test matching the "C" locale isspace() that the old
+ * istream_iterator based tokenizer relied on.
+*/
+inline bool is_space(char c){
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/*
+ * Split line on whitespace
+ *
+ * Only the first MAX_TOKENS tokens are kept since no action uses more,
+ * trailing tokens are ignored just like before.
+ *
+ * @param line - the string to split
+ *        tok  - destination for the token views
+ * @return n   - number of tokens stored in tok
+*/
+std::size_t tokenize(std::string_view line, std::array<std::string_view, MAX_TOKENS>& tok){
+  std::size_t n = 0;
+  std::size_t i = 0;
+  const std::size_t len = line.size();
+  while(n < MAX_TOKENS){
+    while(i < len && is_space(line[i]))
+      ++i;
+    if(i == len)
+      break;
+    std::size_t start = i;
+    while(i < len && !is_space(line[i]))
+      ++i;
+    tok[n++] = line.substr(start, i - start);
+  }
+  return n;
+}
+
+/*
+ * Record the error in the result, the text is only built if asked for
+*/
+parse_result_t& fail(parse_result_t& res, std::string_view oid, const char* msg, std::string_view arg = {}){
+  res.error = msg;
+  res.oid = oid;
+  res.arg = arg;
+  return res;
+}
+
+inline bool is_digit(char c){
+  return c >= '0' && c <= '9';
+}
+
+/*
+ * Negative integer check, equivalent to std::regex("-[0-9]+")
+*/
+bool is_negative_int(std::string_view s){
+  if(s.size() < 2 || s[0] != '-')
+    return false;
+  for(std::size_t i = 1; i < s.size(); ++i)
+    if(!is_digit(s[i]))
+      return false;
+  return true;
+}
+
+/*
+ * Parse an unsigned integer no greater than max
+ *
+ * Accepts the same spelling as boost::lexical_cast<unsigned int>, an
+ * optional leading '+' followed by decimal digits.
+ *
+ * @return bool - false if s is not a valid value
+*/
+bool parse_unsigned(std::string_view s, unsigned long max, unsigned long& val){
+  if(!s.empty() && s[0] == '+')
+    s.remove_prefix(1);
+  if(s.empty() || !is_digit(s[0]))
+    return false;
+  auto r = std::from_chars(s.data(), s.data() + s.size(), val);
+  return r.ec == std::errc() && r.ptr == s.data() + s.size() && val <= max;
+}
+
+/*
+ * 1 to 8 upper case letters and digits
+*/
+bool valid_symbol(std::string_view s){
+  if(s.empty() || s.size() > 8)
+    return false;
+  for(char c : s)
+    if(!is_digit(c) && !(c >= 'A' && c <= 'Z'))
+      return false;
+  return true;
+}
+
+}
+
+/*
+ * Parse a positive decimal price into ticks
+ *
+ * Accepts [+]digits[.digits] where either side of the decimal point may be
+ * empty but not both (i.e. "100", "100.", ".5"). The text is converted
+ * straight to ticks, digits past PX_DECIMALS must be zero since they can not
+ * be represented. Exponents, inf and nan are rejected.
+ *
+ * @return bool - false if s is not a valid price
+*/
+bool parse_price(std::string_view s, px_t& val){
+  const px_t max_whole = std::numeric_limits<px_t>::max() / PX_SCALE;
+  if(!s.empty() && s[0] == '+')
+    s.remove_prefix(1);
+  std::size_t i = 0;
+  std::size_t digits = 0;
+  px_t whole = 0;
+  for(; i < s.size() && is_digit(s[i]); ++i, ++digits){
+    whole = whole * 10 + (s[i] - '0');
+    if(whole >= max_whole)
+      return false;
+  }
+  px_t frac = 0;
+  int places = 0;
+  if(i < s.size() && s[i] == '.'){
+    for(++i; i < s.size() && is_digit(s[i]); ++i, ++digits){
+      if(places == PX_DECIMALS){
+        if(s[i] != '0')
+          return false;
+        continue;
+      }
+      frac = frac * 10 + (s[i] - '0');
+      ++places;
+    }
+  }
+  for(; places < PX_DECIMALS; ++places)
+    frac *= 10;
+  if(i != s.size() || digits == 0)
+    return false;
+  val = whole * PX_SCALE + frac;
+  return true;
+}
+
+/*
+ * Error text of a failed parse, without the "E " prefix
+ *
+ * @param out - string the text is appended to
+ * @return none
+*/
+void ParseResult::append_error(std::string& out) const {
+  out.append(oid.data(), oid.size());
+  out.append(error);
+  out.append(arg.data(), arg.size());
+}
+
+/*
+ * Parse string as request_t struct, without throwing
+ *
+ * Robust error handling for reading requests from actions.txt. Each token
+ * is validated explicitly so that the caller gets a descriptive error
+ * message rather than a single generic one. This is a single pass over the
+ * line with no regex and no copies. A malformed line is reported in the
+ * result as the message and the offending tokens (views into line), so it
+ * costs no more than a valid one: nothing is thrown and nothing touches
+ * the heap until the caller asks for the error text.
+ *
+ * An O may carry a time in force after PX, IOC or FOK.
+ * M amends a resting order, "M OID QTY PX" with QTY its new open
+ * quantity. C is a mass cancel, "C" for the whole book, "C SYMBOL" for
+ * one symbol and "C SYMBOL SIDE" for one side of it. Besides these, a P
+ * is either the bare line "P" for the whole book or
+ * "P SYMBOL [LEVELS]" for a single symbol, optionally only its best
+ * LEVELS price levels on each side.
+ *
+ * @param line - the string that should be parsed
+ * @return res - the request, or the error if res.ok() is false
+*/
+parse_result_t try_parse_request(std::string_view line){
+  parse_result_t res;
+  request_t& rq = res.rq;
+  res.error = nullptr;
+  rq.side = 0;
+  rq.tif = 0;
+  rq.levels = 0;
+  if(line.empty())
+    return fail(res, "", "Missing arguments");
+  if(line == "P"){
+    rq.action = 'P';
+    return res;
+  }
+  std::array<std::string_view, MAX_TOKENS> in;
+  std::size_t n = tokenize(line, in);
+  if(n == 0)
+    return fail(res, "", "Missing arguments");
+
+  unsigned long val;
+  if(in[0] == "P" && n >= 2){
+    rq.action = 'P';
+    if(!valid_symbol(in[1]))
+      return fail(res, "", "Invalid symbol: ", in[1]);
+    rq.symbol = in[1];
+    if(n >= 3){
+      if(!parse_unsigned(in[2], std::numeric_limits<unsigned int>::max(), val) || val == 0)
+        return fail(res, "", "Invalid levels: ", in[2]);
+      rq.levels = static_cast<unsigned int>(val);
+    }
+    return res;
+  }
+
+  if(in[0] == "C"){
+    rq.action = 'C';
+    if(n >= 2){
+      if(!valid_symbol(in[1]))
+        return fail(res, "", "Invalid symbol: ", in[1]);
+      rq.symbol = in[1];
+    }
+    if(n >= 3){
+      if(in[2] != "B" && in[2] != "S")
+        return fail(res, "", "Invalid side: ", in[2]);
+      rq.side = in[2][0];
+    }
+    return res;
+  }
+
+  if(in[0] != "O" && in[0] != "X" && in[0] != "M")
+    return fail(res, "", "Invalid action type: ", in[0]);
+  rq.action = in[0][0];
+  if((rq.action == 'X' && n < 2) || (rq.action == 'O' && n < 6) || (rq.action == 'M' && n < 4))
+    return fail(res, "", "Missing arguments");
+
+  if(is_negative_int(in[1]))
+    return fail(res, in[1], " OID must be positive");
+  if(!parse_unsigned(in[1], std::numeric_limits<unsigned int>::max(), val))
+    return fail(res, in[1], " OID must be an unsigned int");
+  rq.oid = static_cast<unsigned int>(val);
+  if(rq.action == 'X')
+    return res;
+
+  //QTY and PX follow the OID for M, SYMBOL and SIDE for O
+  std::size_t next = 2;
+  if(rq.action == 'O'){
+    if(!valid_symbol(in[2]))
+      return fail(res, in[1], " Invalid symbol: ", in[2]);
+    rq.symbol = in[2];
+
+    if(in[3] != "B" && in[3] != "S")
+      return fail(res, in[1], " Invalid side: ", in[3]);
+    rq.side = in[3][0];
+    next = 4;
+  }
+
+  if(is_negative_int(in[next]))
+    return fail(res, in[1], " QTY must be positive");
+  if(!parse_unsigned(in[next], std::numeric_limits<unsigned short>::max(), val))
+    return fail(res, in[1], " QTY must be an unsigned short");
+  if(val == 0)
+    return fail(res, in[1], " QTY must be positive");
+  rq.qty = static_cast<unsigned short>(val);
+
+  //Like the old -[0-9]+.* match, a bare or non numeric '-' is not a double
+  if(in[next + 1].size() > 1 && in[next + 1][0] == '-' && is_digit(in[next + 1][1]))
+    return fail(res, in[1], " PX must be positive");
+  if(!parse_price(in[next + 1], rq.px))
+    return fail(res, in[1], " PX must be a double");
+
+  if(rq.action == 'O' && n > 6){
+    if(in[6] == "IOC")
+      rq.tif = 'I';
+    else if(in[6] == "FOK")
+      rq.tif = 'F';
+    else
+      return fail(res, in[1], " Invalid time in force: ", in[6]);
+  }
+  return res;
+}
+
+/*
+ * Parse string as request_t struct
+ *
+ * Throwing form of try_parse_request() for callers that prefer to
+ * unwind on malformed input.
+ *
+ * @param line - the string that should be parsed
+ * @return rq  - request_t struct describing the request made
+ * @throws std::invalid_argument - 'E' result string for malformed input
+*/
+request_t parse_request(std::string_view line){
+  parse_result_t res = try_parse_request(line);
+  if(!res.ok()){
+    std::string err("E ");
+    res.append_error(err);
+    throw std::invalid_argument(err);
+  }
+  return res.rq;
+}
@@ -0,0 +1,53 @@
+#ifndef REQUEST_PARSER_H
+#define REQUEST_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "price.h"
+
+/*
+ * Parsed order request
+ *
+ * symbol is a view into the line handed to parse_request() and is only
+ * valid for as long as that line is. For P and C it is empty unless the
+ * action is limited to one symbol. levels limits a P to the best levels
+ * of each side (0 prints every level), side limits a C to one side (0
+ * cancels both). tif is an O's time in force: 0 rests the remainder, 'I'
+ * (IOC) cancels it and 'F' (FOK) only executes if the order fills in full.
+*/
+typedef struct Request
+{
+  char action;
+  unsigned int oid;
+  std::string_view symbol;
+  char side;
+  unsigned short qty;
+  px_t px;
+  unsigned int levels;
+  char tif;
+} request_t;
+
+/*
+ * Outcome of try_parse_request()
+ *
+ * error is nullptr for a valid request. Otherwise the "E" result text is
+ * oid + error + arg, where oid and arg are views into the parsed line
+ * (either may be empty), and rq is only partially filled.
+*/
+typedef struct ParseResult
+{
+  request_t rq;
+  const char* error;
+  std::string_view oid;
+  std::string_view arg;
+
+  bool ok() const { return error == nullptr; }
+  void append_error(std::string& out) const;
+} parse_result_t;
+
+parse_result_t try_parse_request(std::string_view line);
+request_t parse_request(std::string_view line);
+bool parse_price(std::string_view s, px_t& val);
+
+#endif
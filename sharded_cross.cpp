@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <stdexcept>
+#include "sharded_cross.h"
+
+/*
+ * Start the shard workers
+ *
+ * @param shards - number of worker threads/books, 1 to MAX_SHARDS
+*/
+ShardedCross::ShardedCross(unsigned int shards){
+  if(shards == 0 || shards > MAX_SHARDS)
+    throw std::invalid_argument("ShardedCross needs 1 to 255 shards");
+  for(unsigned int i = 0; i < shards; ++i){
+    shards_m.emplace_back(new Shard());
+    shards_m.back()->staged.reserve(BATCH);
+  }
+  for(unsigned int i = 0; i < shards; ++i)
+    shards_m[i]->thread = std::thread(&ShardedCross::run, this, i);
+}
+
+/*
+ * Stop the shard workers
+ *
+ * Requests already submitted are executed before the workers exit,
+ * results that were never collected with next() are dropped (a worker
+ * stops waiting for room on its results ring once stop_m is set).
+*/
+ShardedCross::~ShardedCross(){
+  publish_all();
+  stop_m.store(true, std::memory_order_release);
+  for(auto& shard : shards_m)
+    shard->thread.join();
+}
+
+/*
+ * Shard a symbol belongs to
+ *
+ * Fibonacci hash of the packed symbol key, so every book for a symbol
+ * lives in exactly one shard.
+*/
+unsigned int ShardedCross::symbol_shard(std::string_view symbol) const {
+  uint64_t h = symbol_key(symbol) * 0x9E3779B97F4A7C15ull;
+  return static_cast<unsigned int>((h >> 32) % shards_m.size());
+}
+
+/*
+ * Submit a request
+ *
+ * Parses and routes the line, the caller collects the results with
+ * next() in the same order requests were submitted.
+ *
+ * @param line - the string that represents the order request from the caller.
+ * @return seq - sequence number of the request
+*/
+uint64_t ShardedCross::submit(std::string_view line){
+  task_t task;
+  parse_result_t res = try_parse_request(line);
+  task.rq = res.rq;
+  if(!res.ok()){
+    std::string err("E ");
+    res.append_error(err);
+    errors_m.emplace_back(results_t{err});
+    routes_m.push_back(ROUTE_ERROR);
+    return next_seq_m++;
+  }
+
+  //Symbol is a view into line, carry a copy for the worker
+  std::copy(task.rq.symbol.begin(), task.rq.symbol.end(), task.symbol);
+  switch(task.rq.action){
+    case 'P':
+    case 'C':
+      if(!task.rq.symbol.empty()){
+        dispatch(symbol_shard(task.rq.symbol), task);
+        break;
+      }
+      routes_m.push_back(ROUTE_BROADCAST);
+      for(auto& shard : shards_m){
+        shard->staged.push_back(task);
+        if(shard->staged.size() >= BATCH)
+          publish(*shard);
+      }
+      break;
+    case 'X':
+    case 'M': {
+      int owner = oid_shards_m.find(task.rq.oid);
+      dispatch(owner < 0 ? 0 : owner, task);
+      break;
+    }
+    case 'O': {
+      int owner = oid_shards_m.find(task.rq.oid);
+      if(owner < 0){
+        owner = symbol_shard(task.rq.symbol);
+        oid_shards_m.insert(task.rq.oid, owner);
+      }
+      dispatch(owner, task);
+      break;
+    }
+  }
+  return next_seq_m++;
+}
+
+void ShardedCross::dispatch(unsigned int shard, const task_t& task){
+  shard_t& s = *shards_m[shard];
+  routes_m.push_back(static_cast<int>(shard));
+  s.staged.push_back(task);
+  if(s.staged.size() >= BATCH)
+    publish(s);
+}
+
+/*
+ * Push a shard's staged requests onto its ring
+ *
+ * While the ring is full every shard's results are collected, a worker
+ * may itself be waiting for room to hand its results back.
+*/
+void ShardedCross::publish(shard_t& shard){
+  task_t* next = shard.staged.data();
+  for(std::size_t n = shard.staged.size(); n > 0;){
+    std::size_t pushed = shard.tasks.push(next, n);
+    next += pushed;
+    n -= pushed;
+    if(n > 0){
+      collect();
+      std::this_thread::yield();
+    }
+  }
+  shard.staged.clear();
+}
+
+void ShardedCross::publish_all(){
+  for(auto& shard : shards_m)
+    if(!shard->staged.empty())
+      publish(*shard);
+}
+
+/*
+ * Move every result the workers have handed back to the client side
+*/
+void ShardedCross::collect(){
+  results_t batch[BATCH];
+  for(auto& shard : shards_m)
+    for(std::size_t n; (n = shard->results.pop(batch, BATCH)) > 0;)
+      for(std::size_t i = 0; i < n; ++i)
+        shard->ready.push_back(std::move(batch[i]));
+}
+
+/*
+ * Results of the oldest outstanding request routed to shard
+*/
+results_t ShardedCross::take(unsigned int shard){
+  shard_t& s = *shards_m[shard];
+  while(s.ready.empty()){
+    results_t res;
+    if(s.results.try_pop(res))
+      return res;
+    std::this_thread::yield();
+  }
+  results_t res = std::move(s.ready.front());
+  s.ready.pop_front();
+  return res;
+}
+
+/*
+ * Collect the results of the oldest outstanding request
+ *
+ * Publishes every staged request, then blocks until that request has
+ * been executed by every shard it was routed to.
+ *
+ * @return res - results_t struct describing order book events or errors
+ * @throws std::out_of_range - there is no outstanding request
+*/
+results_t ShardedCross::next(){
+  if(routes_m.empty())
+    throw std::out_of_range("ShardedCross::next() without an outstanding request");
+  int route = routes_m.front();
+  routes_m.pop_front();
+  if(route == ROUTE_ERROR){
+    results_t res = std::move(errors_m.front());
+    errors_m.pop_front();
+    return res;
+  }
+  publish_all();
+  if(route != ROUTE_BROADCAST)
+    return take(static_cast<unsigned int>(route));
+  results_t res;
+  for(unsigned int i = 0; i < shards(); ++i)
+    res.splice(res.end(), take(i));
+  return res;
+}
+
+/*
+ * Execute a single request synchronously
+ *
+ * Convenience for callers that do not pipeline, only valid when there
+ * is no outstanding request.
+*/
+results_t ShardedCross::action(const std::string& line){
+  submit(line);
+  return next();
+}
+
+/*
+ * Shard worker
+ *
+ * Executes the shard's requests in order against its private book and
+ * hands back one results_t per request, until the ShardedCross is
+ * destroyed and every published request has been executed.
+*/
+void ShardedCross::run(unsigned int shard){
+  shard_t& s = *shards_m[shard];
+  task_t tasks[BATCH];
+  results_t results[BATCH];
+  for(;;){
+    std::size_t n = s.tasks.pop(tasks, BATCH);
+    if(n == 0){
+      //Stop is only set once every request has been published
+      if(stop_m.load(std::memory_order_acquire) && (n = s.tasks.pop(tasks, BATCH)) == 0)
+        return;
+      if(n == 0){
+        std::this_thread::yield();
+        continue;
+      }
+    }
+    for(std::size_t i = 0; i < n; ++i){
+      task_t& task = tasks[i];
+      task.rq.symbol = std::string_view(task.symbol, task.rq.symbol.size());
+      results[i].clear();
+      ResultsSink sink(results[i]);
+      s.cross.execute(task.rq, sink);
+    }
+    results_t* next = results;
+    for(std::size_t left = n; left > 0;){
+      std::size_t pushed = s.results.push(next, left);
+      next += pushed;
+      left -= pushed;
+      if(left > 0){
+        if(stop_m.load(std::memory_order_relaxed))
+          break;
+        std::this_thread::yield();
+      }
+    }
+  }
+}
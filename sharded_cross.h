@@ -0,0 +1,127 @@
+#ifndef SHARDED_CROSS_H
+#define SHARDED_CROSS_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "simple_cross.h"
+#include "spsc_ring.h"
+
+/*
+ * Symbol-sharded front end for SimpleCross
+ *
+ * Orders for different symbols never cross, so each symbol is hashed to
+ * one of N shards. Every shard is a worker thread that owns a private
+ * SimpleCross and executes its requests in submission order.
+ *
+ * Routing happens on the submitting thread:
+ *   O - the symbol's shard, or the shard that already owns the OID so the
+ *       duplicate is reported by the book that saw it first
+ *   X, M - the shard that owns the OID (shard 0 if the OID was never used)
+ *   P, C - every shard, the results are concatenated in shard order, a
+ *       single symbol P or C only goes to that symbol's shard
+ * Malformed lines are answered without reaching a shard.
+ *
+ * Requests reach a worker in batches over a per shard SPSC ring and its
+ * results come back in order over a second one, so the hand-off costs no
+ * lock or wakeup per request. submit() stages a request and only
+ * publishes the shard's batch once it holds BATCH requests, next()
+ * publishes every staged request before it waits. Both sides spin (with
+ * a yield) on an empty or full ring, same as the pipeline driver.
+ *
+ * Each shard executes its requests in order and hands back one results_t
+ * per request, so the results of the oldest outstanding request are
+ * always at the front of its shard's results. next() returns them
+ * strictly in submission order and the caller sees exactly what a single
+ * SimpleCross would have produced (other than P and C listing symbols
+ * grouped by shard).
+ *
+ * submit() and next() must be called from a single client thread.
+*/
+class ShardedCross
+{
+  private:
+    static const std::size_t RING_SIZE = 4096;
+    static const std::size_t BATCH = 64;
+    static constexpr int ROUTE_BROADCAST = -1;
+    static constexpr int ROUTE_ERROR = -2;
+
+    typedef struct Task
+    {
+      request_t rq;
+      char symbol[MAX_SYMBOL_LEN];
+    } task_t;
+
+    typedef struct Shard
+    {
+      SimpleCross cross;
+      SpscRing<task_t> tasks{RING_SIZE};
+      SpscRing<results_t> results{RING_SIZE};
+      std::thread thread;
+      //Client side: requests not yet published, results already popped
+      std::vector<task_t> staged;
+      std::deque<results_t> ready;
+    } shard_t;
+
+    /*
+     * OID -> owning shard, for every OID ever accepted
+     *
+     * Chunked like OidSet but one byte (shard + 1) per OID.
+    */
+    class OidShards
+    {
+      private:
+        static const uint32_t CHUNK_BITS = 16;
+        std::vector<std::unique_ptr<uint8_t[]>> chunks_m;
+      public:
+        OidShards() : chunks_m(1u << (32 - CHUNK_BITS)) {}
+        int find(uint32_t oid) const {
+          const uint8_t* chunk = chunks_m[oid >> CHUNK_BITS].get();
+          return chunk ? chunk[oid & ((1u << CHUNK_BITS) - 1)] - 1 : -1;
+        }
+        void insert(uint32_t oid, unsigned int shard){
+          auto& chunk = chunks_m[oid >> CHUNK_BITS];
+          if(!chunk)
+            chunk.reset(new uint8_t[1u << CHUNK_BITS]());
+          chunk[oid & ((1u << CHUNK_BITS) - 1)] = static_cast<uint8_t>(shard + 1);
+        }
+    };
+
+    std::vector<std::unique_ptr<shard_t>> shards_m;
+    OidShards oid_shards_m;
+    std::atomic<bool> stop_m{false};
+    uint64_t next_seq_m = 0;
+    //Route of every outstanding request: a shard, ROUTE_BROADCAST or ROUTE_ERROR
+    std::deque<int> routes_m;
+    std::deque<results_t> errors_m;
+
+    static bool broadcast(const request_t& rq){
+      return (rq.action == 'P' || rq.action == 'C') && rq.symbol.empty();
+    }
+    unsigned int symbol_shard(std::string_view symbol) const;
+    void dispatch(unsigned int shard, const task_t& task);
+    void publish(shard_t& shard);
+    void publish_all();
+    void collect();
+    results_t take(unsigned int shard);
+    void run(unsigned int shard);
+
+  public:
+    static const unsigned int MAX_SHARDS = 255;
+
+    explicit ShardedCross(unsigned int shards);
+    ~ShardedCross();
+    ShardedCross(const ShardedCross&) = delete;
+    ShardedCross& operator=(const ShardedCross&) = delete;
+
+    unsigned int shards() const { return static_cast<unsigned int>(shards_m.size()); }
+    std::size_t outstanding() const { return routes_m.size(); }
+    uint64_t submit(std::string_view line);
+    results_t next();
+    results_t action(const std::string& line);
+};
+
+#endif
@@ -1,5 +1,13 @@
 #include "simple_cross.h"
 
+namespace {
+
+event_t error_event(unsigned int oid, bool has_oid, std::string_view text){
+  return event_t{'E', 0, has_oid, 0, oid, 0, std::string_view(), text};
+}
+
+}
+
 /*
  * Execute order request
  *
@@ -8,265 +16,601 @@
  * order requests are valid and that the request gets processed. Results
  * are passed back to the caller via the results_t struct.
  *
+ * This is a thin adapter over the EventSink overload which formats each
+ * event as it is reported.
+ *
  * @param line - the string that represents the order request from the caller.
  * @return res - results_t struct describing order book events or errors
 */
 results_t SimpleCross::action(const std::string& line){ 
-  request_t rq;
   results_t res;
+  ResultsSink sink(res);
+  action(line, sink);
+  return res;
+}
+
+/*
+ * Execute order request, reporting typed events
+ *
+ * Same as action(line) but every fill, cancel, error and book row is
+ * handed to sink as an event_t in the order results_t would list them.
+ * Nothing is formatted unless the sink asks for it.
+ *
+ * @param line - the string that represents the order request from the caller.
+ *        sink - receiver for the events of this action
+ * @return none
+*/
+void SimpleCross::action(std::string_view line, EventSink& sink){ 
+  //Timed from the parse on, the latency kind is set once the request is known
+  LATENCY_SCOPE(latency_m);
   //Ensure no malformed input
-  try {
-    rq = handle_request(line);
-  }
-  catch(std::invalid_argument& e) {
-    res.push_back(e.what());
-    return res;
+  parse_result_t res = try_parse_request(line);
+  if(!res.ok()){
+    //Text is built in a reused buffer, a flood of bad lines doesn't allocate
+    error_text_m.clear();
+    res.append_error(error_text_m);
+    sink.event(error_event(0, false, error_text_m));
+    return;
   }
+  apply(res.rq, sink);
+}
 
+/*
+ * Answer a line that failed to parse
+ *
+ * For callers that parse requests themselves, so malformed lines are
+ * reported and counted under the error latency kind like action()
+ * does it. Only the report is timed, the parse ran elsewhere.
+ *
+ * @param text - the error text, without the leading "E "
+ *        sink - receiver for the error event
+ * @return none
+*/
+void SimpleCross::reject(std::string_view text, EventSink& sink){
+  LATENCY_SCOPE(latency_m);
+  sink.event(error_event(0, false, text));
+}
+
+/*
+ * Execute an already parsed order request
+ *
+ * For callers that parse requests themselves, e.g. on another thread.
+ * Only the execution is timed, the parse ran elsewhere.
+ *
+ * @param rq   - request_t struct describing the request made
+ *        sink - receiver for the events of this action
+ * @return none
+*/
+void SimpleCross::execute(const request_t& rq, EventSink& sink){
+  LATENCY_SCOPE(latency_m);
+  apply(rq, sink);
+}
+
+/*
+ * Apply a parsed request to the book
+ *
+ * Accepted O, X, M and C requests are appended to the journal, if one is
+ * attached, before they touch the book. Untimed, the caller holds the
+ * latency scope.
+ *
+ * @param rq   - request_t struct describing the request made
+ *        sink - receiver for the events of this action
+ * @return none
+*/
+void SimpleCross::apply(const request_t& rq, EventSink& sink){
   //Perform action requested
   switch(rq.action){
     case 'P':
-      res = print_orders();
+      LATENCY_KIND(latency_m, LAT_PRINT);
+      print_orders(rq.symbol, rq.levels, sink);
       break;
-    case 'X':
+    case 'X': {
       //Check if oid exists
-      if(oids_m[rq.oid] == nullptr){
-        res.push_back("E "+ std::to_string(rq.oid) + " Order id not in the order book");
+      handle_t h = oids_m.find(rq.oid);
+      if(h == NULL_HANDLE){
+        sink.event(error_event(rq.oid, true, "Order id not in the order book"));
         break;
       }
-      erase_order(oids_m[rq.oid]);
-      res.push_back("X "+ std::to_string(rq.oid));
+      LATENCY_KIND(latency_m, LAT_CANCEL);
+      if(journal_m)
+        journal_m->append(rq);
+      erase_order(h);
+      sink.event(event_t{'X', 0, true, 0, rq.oid, 0, std::string_view(), std::string_view()});
       break;
+    }
+    case 'C':
+      LATENCY_KIND(latency_m, LAT_MASS_CANCEL);
+      if(journal_m)
+        journal_m->append(rq);
+      cancel_orders(rq.symbol, rq.side, sink);
+      break;
+    case 'M': {
+      handle_t h = oids_m.find(rq.oid);
+      if(h == NULL_HANDLE){
+        sink.event(error_event(rq.oid, true, "Order id not in the order book"));
+        break;
+      }
+      LATENCY_KIND(latency_m, LAT_MODIFY);
+      if(journal_m)
+        journal_m->append(rq);
+      modify_order(h, rq, sink);
+      break;
+    }
     case 'O':
       //Check if oid has been used
-      if(used_oids_m[rq.oid]){
-        res.push_back("E " + std::to_string(rq.oid) + " Duplicate order id");
+      if(used_oids_m.contains(rq.oid)){
+        sink.event(error_event(rq.oid, true, "Duplicate order id"));
         break;
       }
-      create_order(rq);
-      //Loop handle_cross until there are no opportunities left
-      for(results_t res2 = handle_cross(rq.symbol); res2.size() != 0; res2 = handle_cross(rq.symbol)){
-        res.insert(res.end(), res2.begin(), res2.end());
-      }
+      if(journal_m)
+        journal_m->append(rq);
+      used_oids_m.insert(rq.oid);
+      unsigned int sym_id = intern_symbol(rq.symbol);
+      //FOK executes all or nothing, decided from the level aggregates
+      unsigned short open_qty = rq.qty;
+      if(rq.tif != 'F' || can_fill(rq, order_book_m[sym_id]))
+        //Match against the book first, only the remainder rests
+        open_qty = handle_cross(rq, order_book_m[sym_id], sink);
+      LATENCY_KIND(latency_m, open_qty == rq.qty ? LAT_REST : LAT_CROSS);
+      if(open_qty == 0)
+        break;
+      //IOC and FOK never rest, whatever is left is cancelled
+      if(rq.tif != 0)
+        sink.event(event_t{'X', 0, true, 0, rq.oid, 0, std::string_view(), std::string_view()});
+      else
+        create_order(rq, sym_id, open_qty);
   }
-  return res;
+}
+
+/*
+ * Give a symbol a dense price band
+ *
+ * Levels of the symbol priced on a tick of [low, high] are kept in a
+ * bitmap-indexed array (see ladder.h) instead of the map, which suits
+ * symbols trading in a bounded band: best price and level lookups
+ * become a bit scan and a level is never allocated or freed. Prices
+ * outside the band or off its tick still work, they fall back to the
+ * map. The band applies to both sides and can be set before the
+ * symbol is first seen, or later, in which case its levels are moved
+ * over. A zero tick drops the band.
+ *
+ * @param symbol - the symbol
+ *        low    - lowest price of the band
+ *        high   - highest price of the band
+ *        tick   - price increment between slots, 0 for no band
+ * @return none
+ * @throws std::invalid_argument - the band is empty or has more than
+ *                                 Ladder::MAX_BAND_SLOTS slots
+*/
+void SimpleCross::set_price_band(std::string_view symbol, px_t low, px_t high, px_t tick){
+  if(tick < 0 || (tick > 0 && (high < low || (high - low) / tick >= Ladder::MAX_BAND_SLOTS)))
+    throw std::invalid_argument("invalid price band for " + std::string(symbol));
+  symbol_key_t key = symbol_key(symbol);
+  bands_m[key] = price_band_t{low, high, tick};
+  auto it = symbol_ids_m.find(key);
+  if(it == symbol_ids_m.end())
+    return;
+  //Moving the levels invalidates the orders' level pointers and nodes
+  book_t& book = order_book_m[it->second];
+  for(levels_t* levels : {&book.sells, &book.buys}){
+    levels->set_band(low, high, tick);
+    levels->up(std::numeric_limits<px_t>::min(), [this, levels](level_t& level){
+      levels_t::node_t node = levels->node(level.px);
+      for(handle_t h = level.head; h != NULL_HANDLE; h = orders_m[h].next)
+        orders_m.cold(h) = {&level, node};
+      return true;
+    });
+  }
+}
+
+/*
+ * Look up (or assign) the id of a symbol
+ *
+ * Each symbol is hashed once per action through its packed key. The
+ * first time a symbol is seen it is given the next id and an empty
+ * book at that index of order_book_m, banded if set_price_band asked
+ * for it.
+ *
+ * @param symbol - validated symbol from the request
+ * @return id    - index of the symbol's book in order_book_m
+*/
+unsigned int SimpleCross::intern_symbol(std::string_view symbol){
+  auto ins = symbol_ids_m.try_emplace(symbol_key(symbol), order_book_m.size());
+  if(!ins.second)
+    return ins.first->second;
+  order_book_m.push_back(book_t{std::string(symbol), levels_t(&level_nodes_m), levels_t(&level_nodes_m)});
+  auto band = bands_m.find(ins.first->first);
+  if(band != bands_m.end()){
+    order_book_m.back().sells.set_band(band->second.low, band->second.high, band->second.tick);
+    order_book_m.back().buys.set_band(band->second.low, band->second.high, band->second.tick);
+  }
+  return ins.first->second;
 }
 
 /*
  * Create new order
  *
- * This method allocates an order_t struct from the request and
- * pushes it to the correct order heap.
+ * This method takes an order slot from the order pool, fills
+ * it from the request and appends it to the tail of its price
+ * level, creating the level if this is the first order at that
+ * price.
  *
- * @param rq   - request_t structure describing the order to
- *               be placed in the order book.
+ * @param rq       - request_t structure describing the order to
+ *                   be placed in the order book.
+ *        sym_id   - id of the symbol's book
+ *        open_qty - quantity left after crossing
  * @return none
 */
-void SimpleCross::create_order(request_t rq){
-  used_oids_m[rq.oid] = true;
-  oids_m[rq.oid] = std::shared_ptr<order_t>(new Order());
-  auto& order_heap = order_book_m[rq.symbol][rq.side];
-  *oids_m[rq.oid] = {
-    0, rq.qty, 0, rq.px, rq.oid, 
-    rq.symbol, rq.side
+void SimpleCross::create_order(const request_t& rq, unsigned int sym_id, unsigned short open_qty){
+  handle_t h = orders_m.alloc();
+  oids_m.insert(rq.oid, h);
+  orders_m[h] = {
+    rq.px, rq.oid, sym_id,
+    NULL_HANDLE, NULL_HANDLE,
+    open_qty, rq.side
   };
-  order_heap.push_back(oids_m[rq.oid]);
-  std::push_heap(order_heap.begin(), order_heap.end(), PriceTimeOrder()); 
+  link_order(h);
 }
 
 /*
- * Handle crossing events
+ * Append an order to the tail of its price level
  *
- * Given a symbol's order book, this method checks the tops of both buy and
- * sell heaps and determines if there is a opportunity to fill. If so, the fill
- * is executed and the heaps are popped if the orders are entirely filled. On each
- * order placement ('O' action), this method is called consecutively by SimpleCross::action
- * until the tops of both heaps are incompatible for a fill.
+ * The level is found (or created) from the order's symbol, side and
+ * price, the order joins the back of its queue and the level's
+ * aggregates.
  *
- * @param symbol   - symbol of the order_book to check/execute crossing events
- * @return res     - results_t struct describing the fills executed.
+ * @param h - pool handle of an order not linked into any level
+ * @return none
 */
-results_t SimpleCross::handle_cross(std::string symbol){
-  results_t res; 
-  //Ensure book holds orders for both sides
-  if(order_book_m[symbol].count('B') == 0 || order_book_m[symbol].count('S') == 0)
-    return res;
-  if(order_book_m[symbol]['B'].size() == 0 || order_book_m[symbol]['S'].size() == 0)
-    return res;
-  
-  auto& buy_heap = order_book_m[symbol]['B'];
-  auto& sell_heap = order_book_m[symbol]['S'];
-  auto buy_ord = buy_heap.front();
-  auto sell_ord = sell_heap.front();
-  
-  //Ensure there is an opporunity to fill
-  if(buy_ord->ord_px < sell_ord->ord_px)
-    return res;
-  
-  if(sell_ord->open_qty >= buy_ord->open_qty){
-    sell_ord->fill_qty = buy_ord->open_qty;
-    sell_ord->open_qty -= buy_ord->open_qty;
-    buy_ord->fill_qty = buy_ord->open_qty;
-    buy_ord->open_qty = 0;
+void SimpleCross::link_order(handle_t h){
+  order_t& order = orders_m[h];
+  auto& levels = order_book_m[order.sym_id].side(order.side);
+  auto ins = levels.try_emplace(order.ord_px);
+  orders_m.cold(h) = {ins.level, ins.node};
+  level_t& level = *ins.level;
+  ++level.orders;
+  level.open_qty += order.open_qty;
+  order.prev = level.tail;
+  order.next = NULL_HANDLE;
+  if(level.tail != NULL_HANDLE)
+    orders_m[level.tail].next = h;
+  else
+    level.head = h;
+  level.tail = h;
+}
+
+/*
+ * Modify a resting order
+ *
+ * rq.qty is the order's new open quantity and rq.px its new price.
+ * A decrease at the same price is applied in place and keeps the
+ * order's time priority. Any other change unlinks the order, which
+ * then behaves like a new order at the new price: it is matched
+ * against the opposite side and whatever is left is appended to the
+ * tail of its new level. The order keeps its OID and pool slot, no
+ * new OID is used up.
+ *
+ * @param h    - pool handle of the order
+ *        rq   - the M request
+ *        sink - receiver for the fill events
+ * @return none
+*/
+void SimpleCross::modify_order(handle_t h, const request_t& rq, EventSink& sink){
+  order_t& order = orders_m[h];
+  if(rq.px == order.ord_px && rq.qty <= order.open_qty){
+    orders_m.cold(h).level->open_qty -= order.open_qty - rq.qty;
+    order.open_qty = rq.qty;
+    return;
   }
-  else{
-    buy_ord->fill_qty = sell_ord->open_qty;
-    buy_ord->open_qty -= sell_ord->open_qty;
-    sell_ord->fill_qty = sell_ord->open_qty;
-    sell_ord->open_qty = 0;
+  unlink_order(h);
+  book_t& book = order_book_m[order.sym_id];
+  request_t incoming = {'O', order.oid, book.symbol, order.side, rq.qty, rq.px, 0, 0};
+  unsigned short open_qty = handle_cross(incoming, book, sink);
+  if(open_qty == 0){
+    oids_m.erase(order.oid);
+    orders_m.free(h);
+    return;
   }
+  order.ord_px = rq.px;
+  order.open_qty = open_qty;
+  link_order(h);
+}
 
-  //possibly buying at lower price
-  buy_ord->fill_px = sell_ord->ord_px;
-  sell_ord->fill_px = sell_ord->ord_px;
+/*
+ * Fill-or-kill liquidity check
+ *
+ * Read-only walk of the opposite side's crossing levels, summing
+ * their aggregate open quantity until it covers the order. Nothing
+ * in the book is touched.
+ *
+ * @param rq   - the incoming order
+ *        book - the order's symbol book
+ * @return bool - true if handle_cross would fill rq.qty in full
+*/
+bool SimpleCross::can_fill(const request_t& rq, const book_t& book) const {
+  uint64_t available = 0;
+  //Best level first, stop at the first that doesn't cross or once covered
+  if(rq.side == 'B')
+    book.sells.up(std::numeric_limits<px_t>::min(), [&available, &rq](const level_t& level){
+      return level.px <= rq.px && (available += level.open_qty) < rq.qty;
+    });
+  else
+    book.buys.down(std::numeric_limits<px_t>::max(), [&available, &rq](const level_t& level){
+      return level.px >= rq.px && (available += level.open_qty) < rq.qty;
+    });
+  return available >= rq.qty;
+}
 
-  res.push_back(
-    "F " + std::to_string(sell_ord->oid) +
-    " " + sell_ord->symbol +
-    " " + std::to_string(sell_ord->fill_qty) +
-    " " + std::to_string(sell_ord->fill_px)
-  );
-  res.push_back(
-    "F " + std::to_string(buy_ord->oid) +
-    " " + buy_ord->symbol +
-    " " + std::to_string(buy_ord->fill_qty) +
-    " " + std::to_string(buy_ord->fill_px)
-  );
-  
-  //Check if full fill
-  if(sell_ord->open_qty == 0)
-    erase_top(sell_ord);
-  if(buy_ord->open_qty == 0)
-    erase_top(buy_ord);
-  return res;
+/*
+ * Handle crossing events
+ *
+ * Given an incoming order and its symbol's order book, this method fills
+ * the order against the opposite side before it is rested. Resting orders
+ * are taken in price-time priority from the best level for as long as
+ * they cross the incoming price, and are erased once entirely filled. The
+ * incoming order never touches the book, the caller only rests whatever
+ * quantity is left.
+ *
+ * @param rq       - the incoming order
+ *        book     - the order_book to check/execute crossing events
+ *        sink     - receiver for the fill events
+ * @return open_qty - quantity of the incoming order left unfilled
+*/
+unsigned short SimpleCross::handle_cross(const request_t& rq, book_t& book, EventSink& sink){
+  const bool buy = rq.side == 'B';
+  levels_t& opposite = buy ? book.sells : book.buys;
+  unsigned short open_qty = rq.qty;
+  while(open_qty > 0 && !opposite.empty()){
+    level_t& level = *opposite.best(!buy);
+    //Ensure there is an opporunity to fill
+    if(buy ? level.px > rq.px : level.px < rq.px)
+      break;
+
+    handle_t h = level.head;
+    order_t& resting = orders_m[h];
+    unsigned short fill_qty = std::min(open_qty, resting.open_qty);
+    resting.open_qty -= fill_qty;
+    level.open_qty -= fill_qty;
+    open_qty -= fill_qty;
+
+    //possibly buying at lower price
+    px_t fill_px = buy ? resting.ord_px : rq.px;
+    unsigned int sell_oid = buy ? resting.oid : rq.oid;
+    unsigned int buy_oid = buy ? rq.oid : resting.oid;
+
+    sink.event(event_t{'F', 'S', true, fill_qty, sell_oid, fill_px, book.symbol, std::string_view()});
+    sink.event(event_t{'F', 'B', true, fill_qty, buy_oid, fill_px, book.symbol, std::string_view()});
+
+    //Check if full fill
+    if(resting.open_qty == 0)
+      erase_order(h);
+  }
+  return open_qty;
 }
 
 /*
- * Print all open orders
+ * Print open orders
  *
- * This method prints all the orders still contained
- * in the order_book_m structure. This spans over all
- * symbols throughout the book, printing each order sorted
- * by ORD_PX (greater).
+ * This method prints the orders still contained in the
+ * order_book_m structure, for every symbol (in the order they
+ * were first seen) or for a single one, sorted by ORD_PX
+ * (greater). The levels are already sorted so this streams the
+ * book in a single walk with no copy or sort, and a symbol or
+ * level limit only walks what it prints. An unknown symbol
+ * prints nothing.
  *
- * @param none
- * @return res - list of strings to be printed 
+ * @param symbol - symbol to print, empty for the whole book
+ *        levels - best price levels to print per side, 0 for all
+ *        sink   - receiver for the book row events
+ * @return none
 */
-results_t SimpleCross::print_orders(){
-  results_t res;
-  std::vector<std::shared_ptr<order_t>> sorted_orders;
-  for(auto symbol_book : order_book_m){
-    sorted_orders = symbol_book.second['B'];
-    sorted_orders.insert(sorted_orders.end(), symbol_book.second['S'].begin(), symbol_book.second['S'].end());
-    std::sort(sorted_orders.begin(), sorted_orders.end(), SortedOrder());
-    for(auto order : sorted_orders){
-      res.push_back(
-        "P " + std::to_string(order->oid) + " " + order->symbol + " " + 
-        order->side + " " + std::to_string(order->open_qty) + 
-        " " + std::to_string(order->ord_px)
-      );
-    } 
+void SimpleCross::print_orders(std::string_view symbol, unsigned int levels, EventSink& sink) const {
+  if(symbol.empty()){
+    for(const auto& book : order_book_m)
+      print_book(book, levels, sink);
+    return;
   }
-  return res;
+  auto it = symbol_ids_m.find(symbol_key(symbol));
+  if(it != symbol_ids_m.end())
+    print_book(order_book_m[it->second], levels, sink);
 }
 
+/*
+ * Print the open orders of one symbol
+ *
+ * Sells are printed from the back of each level's queue to
+ * the front and buys from the front to the back, so the book
+ * reads top to bottom like a ladder. With a level limit only
+ * the best levels of each side (lowest sells, highest buys)
+ * are printed, still top to bottom.
+ *
+ * @param book   - the symbol's book
+ *        levels - best price levels to print per side, 0 for all
+ *        sink   - receiver for the book row events
+ * @return none
+*/
+void SimpleCross::print_book(const book_t& book, unsigned int levels, EventSink& sink) const {
+  auto print = [this, &sink, &book](handle_t h){
+    const order_t& order = orders_m[h];
+    sink.event(event_t{'P', order.side, true, order.open_qty, order.oid, order.ord_px, book.symbol, std::string_view()});
+  };
+  px_t sell_top = std::numeric_limits<px_t>::max();
+  if(levels > 0){
+    unsigned int found = 0;
+    book.sells.up(std::numeric_limits<px_t>::min(), [&found, &sell_top, levels](const level_t& level){
+      sell_top = level.px;
+      return ++found < levels;
+    });
+  }
+  book.sells.down(sell_top, [this, &print](const level_t& level){
+    for(handle_t h = level.tail; h != NULL_HANDLE; h = orders_m[h].prev)
+      print(h);
+    return true;
+  });
+  unsigned int printed = 0;
+  book.buys.down(std::numeric_limits<px_t>::max(), [this, &print, &printed, levels](const level_t& level){
+    for(handle_t h = level.head; h != NULL_HANDLE; h = orders_m[h].next)
+      print(h);
+    return levels == 0 || ++printed < levels;
+  });
+}
 
 /*
- * Erase order_heap's root order
+ * Mass cancel
  *
- * This method deletes the root order from the heap
- * by using std::pop_heap which keeps the integrity
- * of the structure.
+ * Cancels every resting order of the whole book, of one symbol or
+ * of one side of a symbol, reporting an X event per order. Each
+ * side is released in a single streaming pass over its levels:
+ * every order is reported and its slot returned to the pool, then
+ * the side's levels are cleared at once rather than unlinked order
+ * by order. Cancelling the whole book also clears oids_m in one
+ * sweep instead of erasing each OID. OIDs stay used. An unknown
+ * symbol cancels nothing.
  *
- * @param order - the root of the order_heap that is to be removed
+ * @param symbol - symbol to cancel, empty for the whole book
+ *        side   - 'B' or 'S' to cancel one side, 0 for both
+ *        sink   - receiver for the X events
  * @return none
 */
-void SimpleCross::erase_top(std::shared_ptr<order_t> order){
-  auto& order_heap = order_book_m[order->symbol][order->side];
-  std::pop_heap(order_heap.begin(), order_heap.end(), PriceTimeOrder());
-  order_heap.pop_back();
-  oids_m.erase(order->oid);
+void SimpleCross::cancel_orders(std::string_view symbol, char side, EventSink& sink){
+  if(symbol.empty()){
+    for(auto& book : order_book_m){
+      cancel_levels(book.sells, false, sink);
+      cancel_levels(book.buys, false, sink);
+    }
+    oids_m.clear();
+    return;
+  }
+  auto it = symbol_ids_m.find(symbol_key(symbol));
+  if(it == symbol_ids_m.end())
+    return;
+  book_t& book = order_book_m[it->second];
+  if(side != 'B')
+    cancel_levels(book.sells, true, sink);
+  if(side != 'S')
+    cancel_levels(book.buys, true, sink);
 }
 
 /*
- * Erase order from the order_book
+ * Release every order of one side of a book
  *
- * This method deletes the specified order from the book by 
- * pushing it to the top of heap via modifying its ord_px.
+ * Orders are reported in price order, each level head to tail.
  *
- * @param order - the order that should be removed
+ * @param levels     - the side to clear
+ *        erase_oids - erase each OID from oids_m (false when the
+ *                     caller clears the whole index)
+ *        sink       - receiver for the X events
  * @return none
 */
-void SimpleCross::erase_order(std::shared_ptr<order_t> order){
-  auto& order_heap = order_book_m[order->symbol][order->side];
-  if(order->side == 'B')
-    order->ord_px = std::numeric_limits<double>::max();
+void SimpleCross::cancel_levels(levels_t& levels, bool erase_oids, EventSink& sink){
+  levels.up(std::numeric_limits<px_t>::min(), [this, erase_oids, &sink](const level_t& level){
+    for(handle_t h = level.head; h != NULL_HANDLE;){
+      const order_t& order = orders_m[h];
+      handle_t next = order.next;
+      sink.event(event_t{'X', 0, true, 0, order.oid, 0, std::string_view(), std::string_view()});
+      if(erase_oids)
+        oids_m.erase(order.oid);
+      orders_m.free(h);
+      h = next;
+    }
+    return true;
+  });
+  levels.clear();
+}
+
+/*
+ * Best bid and ask of a symbol
+ *
+ * One symbol lookup, then each side is read straight off its best
+ * level's aggregates, O(1) (the first or last level of the map, or a
+ * couple of bit scans in a dense band).
+ *
+ * @param symbol - symbol to query
+ * @return top   - best bid and ask, an empty side (or an unknown
+ *                 symbol) has orders == 0
+*/
+top_of_book_t SimpleCross::top_of_book(std::string_view symbol) const {
+  top_of_book_t top = {{0, 0, 0}, {0, 0, 0}};
+  auto it = symbol_ids_m.find(symbol_key(symbol));
+  if(it == symbol_ids_m.end())
+    return top;
+  const book_t& book = order_book_m[it->second];
+  if(const level_t* bid = book.buys.best(true))
+    top.bid = {bid->px, bid->open_qty, bid->orders};
+  if(const level_t* ask = book.sells.best(false))
+    top.ask = {ask->px, ask->open_qty, ask->orders};
+  return top;
+}
+
+/*
+ * Aggregated depth of one side of a symbol
+ *
+ * Fills out with up to levels price levels, best first, from the level
+ * aggregates. Costs O(levels) and does not allocate, out is the
+ * caller's buffer.
+ *
+ * @param symbol - symbol to query
+ *        side   - 'B' or 'S'
+ *        out    - destination for at least levels quotes
+ *        levels - maximum number of levels to report
+ * @return n     - number of levels written to out
+*/
+std::size_t SimpleCross::depth(std::string_view symbol, char side, quote_t* out, std::size_t levels) const {
+  auto it = symbol_ids_m.find(symbol_key(symbol));
+  if(levels == 0 || it == symbol_ids_m.end())
+    return 0;
+  const book_t& book = order_book_m[it->second];
+  std::size_t n = 0;
+  auto report = [&n, out, levels](const level_t& level){
+    out[n++] = {level.px, level.open_qty, level.orders};
+    return n < levels;
+  };
+  if(side == 'B')
+    book.buys.down(std::numeric_limits<px_t>::max(), report);
   else
-    order->ord_px = 0;
-  std::make_heap(order_heap.begin(), order_heap.end(), PriceTimeOrder());
-  std::pop_heap(order_heap.begin(), order_heap.end(), PriceTimeOrder());
-  order_heap.pop_back();
-  oids_m.erase(order->oid);
+    book.sells.up(std::numeric_limits<px_t>::min(), report);
+  return n;
+}
+
+/*
+ * Erase order from the order_book
+ *
+ * This method unlinks the specified order from its price level
+ * in O(1) and returns the order's slot to the pool.
+ *
+ * @param h - pool handle of the order that should be removed
+ * @return none
+*/
+void SimpleCross::erase_order(handle_t h){
+  unlink_order(h);
+  oids_m.erase(orders_m[h].oid);
+  orders_m.free(h);
 }
 
 /*
- * Parse string as request_t struct
+ * Unlink order from its price level
  *
- * Robust error handling for reading requests from actions.txt. 
- * This could be done with a single regex, however, it would be at the 
- * expense of a single generic error message. Rather than that I've
- * prioritized being explicit.
+ * O(1) removal from the level's queue and aggregates, the level is
+ * erased once it holds no more orders. The order keeps its slot and
+ * OID index entry.
  *
- * @param line - the string that should be parsed
- * @return rq  - request_t struct describing the request made
+ * @param h - pool handle of a linked order
+ * @return none
 */
-request_t SimpleCross::handle_request(const std::string& line){
-  if(line == "")
-    throw std::invalid_argument("E Missing arguments");
-  request_t rq;
-  if(line == "P"){
-    rq.action = 'P';
-    return rq;
-  }
-  std::istringstream iss(line);
-  std::vector<std::string> in{std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{}};
-  
-  if(!std::regex_match(in[0], std::regex("[OX]")))
-    throw std::invalid_argument("E Invalid action type: " + in[0]);
-  rq.action = in[0].at(0);
-  if((rq.action == 'X' && in.size() < 2) | (rq.action == 'O' && in.size() < 6))
-    throw std::invalid_argument("E Missing arguments");
-  if(std::regex_match(in[1], std::regex("-[0-9]+")))
-    throw std::invalid_argument("E " + in[1] + " OID must be positive");
-  try {
-    rq.oid = boost::lexical_cast<unsigned int>(in[1]);
-  }
-  catch(boost::bad_lexical_cast &) {
-    throw std::invalid_argument("E " + in[1] + " OID must be an unsigned int");
-  }
-  if(rq.action == 'X')
-    return rq;
-  if(!std::regex_match(in[2], std::regex("[A-Z0-9]{1,8}")))
-    throw std::invalid_argument("E " + in[1] + " Invalid symbol: "+ in[2]);
-  rq.symbol = in[2];
-  if(!std::regex_match(in[3], std::regex("[BS]")))
-    throw std::invalid_argument("E " + in[1] + " Invalid side: " + in[3]);
-  rq.side = in[3].at(0);
-  if(std::regex_match(in[4], std::regex("-[0-9]+")))
-    throw std::invalid_argument("E " + in[1] + " QTY must be positive");
-  try {
-    rq.qty = boost::lexical_cast<unsigned int>(in[4]);
-  }
-  catch(boost::bad_lexical_cast &) {
-    throw std::invalid_argument("E " + in[1] + " QTY must be an unsigned short");
-  }
-  if(std::regex_match(in[5], std::regex("-[0-9]+(.*)")))
-    throw std::invalid_argument("E " + in[1] + " PX must be positive");
-  try {
-    rq.px = boost::lexical_cast<double>(in[5]);
-  }
-  catch(boost::bad_lexical_cast &) {
-    throw std::invalid_argument("E " + in[1] + " PX must be a double");
-  }
-  return rq;
+void SimpleCross::unlink_order(handle_t h){
+  order_t& order = orders_m[h];
+  order_info_t& info = orders_m.cold(h);
+  level_t& level = *info.level;
+  --level.orders;
+  level.open_qty -= order.open_qty;
+  if(order.prev != NULL_HANDLE)
+    orders_m[order.prev].next = order.next;
+  else
+    level.head = order.next;
+  if(order.next != NULL_HANDLE)
+    orders_m[order.next].prev = order.prev;
+  else
+    level.tail = order.prev;
+  if(level.head == NULL_HANDLE)
+    order_book_m[order.sym_id].side(order.side).erase(&level, info.node);
 }
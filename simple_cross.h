@@ -1,95 +1,172 @@
+#ifndef SIMPLE_CROSS_H
+#define SIMPLE_CROSS_H
+
 #include <iostream>
 #include <list>
 #include <map>
 #include <string>
 #include <vector>
-#include <regex>
-#include <algorithm>
 #include <limits>
-#include "boost/lexical_cast.hpp"
+#include <stdexcept>
+#include <unordered_map>
+#include "events.h"
+#include "latency.h"
+#include "journal.h"
+#include "ladder.h"
+#include "oid_index.h"
+#include "pool.h"
+#include "price.h"
+#include "symbol.h"
+#include "request_parser.h"
 
 typedef std::list<std::string> results_t;
 
-typedef struct Order
+/*
+ * Aggregate of one price level, as reported by depth queries
+ *
+ * An empty side is reported with orders == 0 (px and open_qty 0).
+*/
+typedef struct Quote
 {
-  unsigned short fill_qty;
-  unsigned short open_qty;
-  double fill_px;
-  double ord_px;
-  unsigned int oid;
-  std::string symbol;
-  char side;
-} order_t;
+  px_t px;
+  uint64_t open_qty;
+  uint32_t orders;
+} quote_t;
 
-typedef struct Request
+/*
+ * Best bid and best ask of a symbol
+*/
+typedef struct TopOfBook
 {
-  char action;
-  unsigned int oid;
-  std::string symbol;
-  char side;
-  unsigned short qty;
-  double px;
-} request_t;
+  quote_t bid;
+  quote_t ask;
+} top_of_book_t;
 
 /*
- * Price-Time FIFO ordering for the heaps used in the order book
+ * One side of a symbol's book, see ladder.h
  *
- * ASSUMPTION: order ids destined for map[symbol][side] are larger than previous
- *             order ids already in the destination.
- * 
- * This is the comparator function for the heap. It prioritizes high buy prices
- * and low sell prices. If two orders have the same price, the lower order id
- * is prioritized to ensure FIFO ordering
+ * Best price is best(false) for sells and best(true) for buys.
+*/
+typedef Ladder levels_t;
+
+/*
+ * Dense price band of a symbol, see SimpleCross::set_price_band
+*/
+typedef struct PriceBand
+{
+  px_t low;
+  px_t high;
+  px_t tick;
+} price_band_t;
+
+/*
+ * Order, hot part
  *
- * @param  ord1 - parent of ord2
-           ord2 - child of ord1
- * @return bool - if the nodes the nodes in the heap should be swapped
+ * Everything read while walking a price level (matching and printing),
+ * packed into 32 bytes so that two orders share a cache line.
 */
-struct PriceTimeOrder {
-  bool operator()(std::shared_ptr<order_t> ord1, std::shared_ptr<order_t> ord2)
-  {
-    //Prioritize lower oid
-    if(ord1->ord_px == ord2->ord_px)
-      return ord1->oid > ord2->oid;
-
-    //Prioritize higher buy price
-    if(ord1->side == 'B')
-      return ord1->ord_px < ord2->ord_px;
-
-    //Prioritize lower sell price
-    return ord1->ord_px > ord2->ord_px;
-  }
-};
+typedef struct alignas(32) Order
+{
+  px_t ord_px;
+  unsigned int oid;
+  unsigned int sym_id;
+  handle_t prev;
+  handle_t next;
+  unsigned short open_qty;
+  char side;
+} order_t;
+
+static_assert(sizeof(order_t) == 32, "order_t must stay half a cache line");
 
 /*
- * Sorted Order for printing order books
+ * Order, cold part
  *
- * This is the comparator function for print_orders(). It prioritizes high
- * order price across all maps.
+ * Only touched when the order leaves its level. The level's map node is
+ * kept so that the last order out erases the level without a search.
+*/
+typedef struct OrderInfo
+{
+  level_t* level;
+  levels_t::node_t node;
+} order_info_t;
+
+typedef Pool<order_t, order_info_t> order_pool_t;
+
+/*
+ * Order book for a single symbol
  *
- * @param  ord1 - parent of ord2
-           ord2 - child of ord1
- * @return bool - if the nodes the nodes should be swapped
+ * Books live in a contiguous array indexed by the symbol id handed out
+ * by SimpleCross::intern_symbol().
 */
-struct SortedOrder {
-  bool operator()(std::shared_ptr<order_t> ord1, std::shared_ptr<order_t> ord2)
-  {
-    return ord1->ord_px >= ord2->ord_px;
-  }
+typedef struct Book
+{
+  std::string symbol;
+  levels_t buys;
+  levels_t sells;
+
+  levels_t& side(char side){ return side == 'B' ? buys : sells; }
+} book_t;
+
+/*
+ * EventSink that formats every event into a results_t
+*/
+class ResultsSink : public EventSink
+{
+  private:
+    results_t& res_m;
+  public:
+    explicit ResultsSink(results_t& res) : res_m(res) {}
+    void event(const event_t& ev) override { res_m.push_back(format_event(ev)); }
 };
 
 class SimpleCross
 {
   private:
-    std::unordered_map<std::string, std::unordered_map<char, std::vector<std::shared_ptr<order_t>>>> order_book_m; 
-    std::unordered_map<unsigned int, std::shared_ptr<order_t>> oids_m;
-    std::unordered_map<unsigned int, bool> used_oids_m;
-    results_t print_orders(); 
-    void erase_order(std::shared_ptr<order_t> order); 
-    void erase_top(std::shared_ptr<order_t> order); 
-    void create_order(request_t rq); 
-    results_t handle_cross(std::string symbol); 
-    request_t handle_request(const std::string& line);
+    BlockPool level_nodes_m;
+    std::vector<book_t> order_book_m; 
+    std::unordered_map<symbol_key_t, unsigned int> symbol_ids_m;
+    std::unordered_map<symbol_key_t, price_band_t> bands_m;
+    order_pool_t orders_m;
+    OidIndex oids_m;
+    OidSet used_oids_m;
+    Journal* journal_m = nullptr;
+    std::string error_text_m;
+#ifdef SIMPLE_CROSS_LATENCY
+    LatencyStats latency_m;
+#endif
+    void print_book(const book_t& book, unsigned int levels, EventSink& sink) const;
+    void erase_order(handle_t h); 
+    void link_order(handle_t h);
+    void unlink_order(handle_t h);
+    void modify_order(handle_t h, const request_t& rq, EventSink& sink);
+    void apply(const request_t& rq, EventSink& sink);
+    void cancel_levels(levels_t& levels, bool erase_oids, EventSink& sink);
+    unsigned int intern_symbol(std::string_view symbol); 
+    void create_order(const request_t& rq, unsigned int sym_id, unsigned short open_qty); 
+    bool can_fill(const request_t& rq, const book_t& book) const;
+    unsigned short handle_cross(const request_t& rq, book_t& book, EventSink& sink); 
   public:
+    SimpleCross() = default;
+    SimpleCross(const SimpleCross&) = delete;
+    SimpleCross& operator=(const SimpleCross&) = delete;
+
     results_t action(const std::string& line); 
+    void action(std::string_view line, EventSink& sink); 
+    void execute(const request_t& rq, EventSink& sink); 
+    void reject(std::string_view text, EventSink& sink);
+    void print_orders(std::string_view symbol, unsigned int levels, EventSink& sink) const;
+    void cancel_orders(std::string_view symbol, char side, EventSink& sink);
+    top_of_book_t top_of_book(std::string_view symbol) const;
+    std::size_t depth(std::string_view symbol, char side, quote_t* out, std::size_t levels) const;
+    void set_journal(Journal* journal){ journal_m = journal; }
+    void set_price_band(std::string_view symbol, px_t low, px_t high, px_t tick);
+    void save_snapshot(const char* path) const;
+    uint64_t load_snapshot(const char* path);
+    const pool_stats_t& pool_stats() const { return orders_m.stats(); }
+    const pool_stats_t& level_stats() const { return level_nodes_m.stats(); }
+#ifdef SIMPLE_CROSS_LATENCY
+    const LatencyStats& latency() const { return latency_m; }
+#endif
 };
+
+#endif
@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "io.h"
+#include "simple_cross.h"
+#include "snapshot.h"
+
+namespace {
+
+const std::size_t BUFFER_SIZE = 1 << 20;
+
+[[noreturn]] void damaged(const char* path){
+  throw std::runtime_error(std::string("snapshot ") + path + " is damaged");
+}
+
+/*
+ * Buffered sequential writer, owns the descriptor
+*/
+class SnapshotWriter
+{
+  private:
+    int fd_m;
+    std::unique_ptr<char[]> buf_m;
+    std::size_t len_m = 0;
+  public:
+    explicit SnapshotWriter(int fd) : fd_m(fd), buf_m(new char[BUFFER_SIZE]) {}
+    ~SnapshotWriter(){ ::close(fd_m); }
+
+    template <typename T>
+    void put(const T& rec){
+      if(len_m + sizeof(T) > BUFFER_SIZE)
+        flush();
+      std::memcpy(buf_m.get() + len_m, &rec, sizeof(T));
+      len_m += sizeof(T);
+    }
+
+    void flush(){
+      std::size_t len = len_m;
+      len_m = 0;
+      write_all(fd_m, buf_m.get(), len, "snapshot write");
+    }
+
+    void sync(){
+      flush();
+      while(::fsync(fd_m) != 0)
+        if(errno != EINTR)
+          fail_errno("snapshot fsync");
+    }
+};
+
+/*
+ * Buffered sequential reader, owns the descriptor
+*/
+class SnapshotReader
+{
+  private:
+    int fd_m;
+    const char* path_m;
+    std::unique_ptr<char[]> buf_m;
+    std::size_t pos_m = 0;
+    std::size_t len_m = 0;
+
+    bool fill(){
+      std::memmove(buf_m.get(), buf_m.get() + pos_m, len_m - pos_m);
+      len_m -= pos_m;
+      pos_m = 0;
+      for(;;){
+        ssize_t n = ::read(fd_m, buf_m.get() + len_m, BUFFER_SIZE - len_m);
+        if(n < 0){
+          if(errno == EINTR)
+            continue;
+          fail_errno(std::string("read ") + path_m);
+        }
+        len_m += static_cast<std::size_t>(n);
+        return n > 0;
+      }
+    }
+  public:
+    SnapshotReader(int fd, const char* path) : fd_m(fd), path_m(path), buf_m(new char[BUFFER_SIZE]) {}
+    ~SnapshotReader(){ ::close(fd_m); }
+
+    template <typename T>
+    T get(){
+      while(len_m - pos_m < sizeof(T))
+        if(!fill())
+          damaged(path_m);
+      T rec;
+      std::memcpy(&rec, buf_m.get() + pos_m, sizeof(T));
+      pos_m += sizeof(T);
+      return rec;
+    }
+
+    bool at_end(){
+      return pos_m == len_m && !fill();
+    }
+};
+
+}
+
+/*
+ * Save the book to a snapshot file
+ *
+ * Writes every book with its levels and resting orders in FIFO order,
+ * plus the used-OID set, in the format described in snapshot.h. The file
+ * is written next to path and renamed over it once synced, so a crash
+ * never leaves a half written snapshot behind. An attached journal is
+ * committed first and its position recorded, recovery then only needs
+ * the journal records after it.
+ *
+ * @param path - the snapshot file
+ * @return none
+ * @throws std::runtime_error - the file can not be written
+*/
+void SimpleCross::save_snapshot(const char* path) const {
+  if(journal_m)
+    journal_m->commit();
+  std::string tmp = std::string(path) + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    fail_errno("open " + tmp);
+  try {
+    SnapshotWriter out(fd);
+    snapshot_header_t header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, journal_m ? journal_m->appended() : 0,
+      orders_m.stats().live, static_cast<uint32_t>(order_book_m.size()), 0};
+    for(uint32_t i = 0; i < OidSet::CHUNKS; ++i)
+      header.chunks += used_oids_m.chunk(i) != nullptr;
+    out.put(header);
+
+    for(const auto& book : order_book_m){
+      out.put(snapshot_book_t{symbol_key(book.symbol), static_cast<uint32_t>(book.sells.size()),
+        static_cast<uint32_t>(book.buys.size())});
+      for(const levels_t* levels : {&book.sells, &book.buys}){
+        levels->up(std::numeric_limits<px_t>::min(), [this, &out](const level_t& level){
+          out.put(snapshot_level_t{level.px, level.orders, 0});
+          for(handle_t h = level.head; h != NULL_HANDLE; h = orders_m[h].next)
+            out.put(snapshot_order_t{orders_m[h].oid, orders_m[h].open_qty, 0});
+          return true;
+        });
+      }
+    }
+
+    for(uint32_t i = 0; i < OidSet::CHUNKS; ++i){
+      const uint64_t* chunk = used_oids_m.chunk(i);
+      if(!chunk)
+        continue;
+      out.put(snapshot_chunk_t{i, 0});
+      for(uint32_t w = 0; w < OidSet::CHUNK_WORDS; ++w)
+        out.put(chunk[w]);
+    }
+    out.sync();
+  }
+  catch(std::runtime_error&) {
+    ::unlink(tmp.c_str());
+    throw;
+  }
+  if(::rename(tmp.c_str(), path) != 0){
+    ::unlink(tmp.c_str());
+    fail_errno(std::string("rename ") + path);
+  }
+}
+
+/*
+ * Restore the book from a snapshot file
+ *
+ * Bulk load into an empty SimpleCross: levels arrive sorted and are
+ * appended at the end of their ladder, orders are linked straight onto
+ * their level's tail and oids_m is sized once for all of them, so the
+ * load is linear in the size of the snapshot. If the file turns out to
+ * be damaged the book is left partially loaded and should be discarded.
+ *
+ * @param path - the snapshot file
+ * @return journal_seq - journal records already reflected in the book,
+ *                       pass it to recover() to replay only the rest
+ * @throws std::runtime_error - the book is not empty, or the file can
+ *                              not be read or is not a valid snapshot
+*/
+uint64_t SimpleCross::load_snapshot(const char* path){
+  if(!order_book_m.empty() || used_oids_m.size() > 0)
+    throw std::runtime_error("load_snapshot needs an empty book");
+  int fd = ::open(path, O_RDONLY);
+  if(fd < 0)
+    fail_errno(std::string("open ") + path);
+  SnapshotReader in(fd, path);
+  snapshot_header_t header = in.get<snapshot_header_t>();
+  if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+    throw std::runtime_error(std::string("snapshot ") + path + " has no valid header");
+
+  order_book_m.reserve(header.books);
+  oids_m.reserve(header.orders);
+  uint64_t orders = 0;
+  for(uint32_t b = 0; b < header.books; ++b){
+    snapshot_book_t rec = in.get<snapshot_book_t>();
+    unsigned int sym_id = intern_symbol(key_symbol(rec.symbol));
+    if(sym_id != b)
+      damaged(path);
+
+    for(char side : {'S', 'B'}){
+      levels_t& levels = order_book_m[sym_id].side(side);
+      uint32_t count = side == 'S' ? rec.sell_levels : rec.buy_levels;
+      px_t last_px = 0;
+      for(uint32_t l = 0; l < count; ++l){
+        snapshot_level_t lrec = in.get<snapshot_level_t>();
+        //A price of 0 is valid, only the levels after the first must ascend
+        if(lrec.orders == 0 || (l > 0 && lrec.px <= last_px))
+          damaged(path);
+        last_px = lrec.px;
+        auto ins = levels.try_emplace(lrec.px);
+        level_t& level = *ins.level;
+        level.orders = lrec.orders;
+        for(uint32_t o = 0; o < lrec.orders; ++o){
+          snapshot_order_t orec = in.get<snapshot_order_t>();
+          if(orec.open_qty == 0 || oids_m.find(orec.oid) != NULL_HANDLE)
+            damaged(path);
+          handle_t h = orders_m.alloc();
+          orders_m[h] = {lrec.px, orec.oid, sym_id, level.tail, NULL_HANDLE, orec.open_qty, side};
+          orders_m.cold(h) = {&level, ins.node};
+          if(level.tail != NULL_HANDLE)
+            orders_m[level.tail].next = h;
+          else
+            level.head = h;
+          level.tail = h;
+          level.open_qty += orec.open_qty;
+          oids_m.insert(orec.oid, h);
+        }
+        orders += lrec.orders;
+      }
+    }
+  }
+  if(orders != header.orders)
+    damaged(path);
+
+  std::unique_ptr<uint64_t[]> words(new uint64_t[OidSet::CHUNK_WORDS]);
+  for(uint32_t c = 0; c < header.chunks; ++c){
+    snapshot_chunk_t crec = in.get<snapshot_chunk_t>();
+    if(crec.index >= OidSet::CHUNKS || used_oids_m.chunk(crec.index))
+      damaged(path);
+    for(uint32_t w = 0; w < OidSet::CHUNK_WORDS; ++w)
+      words[w] = in.get<uint64_t>();
+    used_oids_m.load_chunk(crec.index, words.get());
+  }
+  if(!in.at_end())
+    damaged(path);
+  return header.journal_seq;
+}
@@ -0,0 +1,65 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+
+/*
+ * Book snapshot file format
+ *
+ * Host endian, every record 8 byte aligned:
+ *
+ *   snapshot_header_t
+ *   per book, in symbol id order (empty books included so P keeps its order)
+ *     snapshot_book_t
+ *     sell levels then buy levels, each ascending by price
+ *       snapshot_level_t
+ *       snapshot_order_t x orders, head to tail
+ *   per allocated OidSet chunk, ascending
+ *     snapshot_chunk_t
+ *     uint64_t x OidSet::CHUNK_WORDS
+ *
+ * Levels and orders are stored in the order the book keeps them, so a
+ * load appends every level at the end of its ladder and every order at the
+ * tail of its level without a search. oids_m is rebuilt from the orders.
+*/
+typedef struct SnapshotHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t journal_seq; //journal records already reflected in the snapshot
+  uint64_t orders;
+  uint32_t books;
+  uint32_t chunks;
+} snapshot_header_t;
+
+typedef struct SnapshotBook
+{
+  uint64_t symbol;
+  uint32_t sell_levels;
+  uint32_t buy_levels;
+} snapshot_book_t;
+
+typedef struct SnapshotLevel
+{
+  int64_t px;
+  uint32_t orders;
+  uint32_t reserved;
+} snapshot_level_t;
+
+typedef struct SnapshotOrder
+{
+  uint32_t oid;
+  uint16_t open_qty;
+  uint16_t reserved;
+} snapshot_order_t;
+
+typedef struct SnapshotChunk
+{
+  uint32_t index;
+  uint32_t reserved;
+} snapshot_chunk_t;
+
+const uint32_t SNAPSHOT_MAGIC = 0x534e5853; //"SXNS"
+const uint32_t SNAPSHOT_VERSION = 1;
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/*
+ * Bounded lock-free single-producer/single-consumer ring
+ *
+ * One thread may push and one (other) thread may pop. head_m is only
+ * written by the consumer and tail_m only by the producer, each on its
+ * own cache line, and each side keeps a private copy of the other's index
+ * so the shared line is only read when the cached one says the ring looks
+ * full (producer) or empty (consumer). Batch push/pop publish a whole run
+ * of slots with a single release store.
+ *
+ * Capacity is rounded up to a power of two. Items are moved in and out.
+*/
+template <typename T>
+class SpscRing
+{
+  private:
+    static const std::size_t CACHE_LINE = 64;
+
+    std::unique_ptr<T[]> slots_m;
+    std::size_t mask_m;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> head_m{0};
+    std::size_t cached_tail_m = 0;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail_m{0};
+    std::size_t cached_head_m = 0;
+
+    char pad_m[CACHE_LINE - sizeof(std::size_t) * 2];
+
+  public:
+    explicit SpscRing(std::size_t capacity){
+      std::size_t c = 2;
+      while(c < capacity)
+        c <<= 1;
+      slots_m.reset(new T[c]);
+      mask_m = c - 1;
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const { return mask_m + 1; }
+
+    /*
+     * Producer: move up to n items in, returns how many fit
+    */
+    std::size_t push(T* items, std::size_t n){
+      const std::size_t tail = tail_m.load(std::memory_order_relaxed);
+      if(capacity() - (tail - cached_head_m) < n)
+        cached_head_m = head_m.load(std::memory_order_acquire);
+      std::size_t free = capacity() - (tail - cached_head_m);
+      if(n > free)
+        n = free;
+      for(std::size_t i = 0; i < n; ++i)
+        slots_m[(tail + i) & mask_m] = std::move(items[i]);
+      tail_m.store(tail + n, std::memory_order_release);
+      return n;
+    }
+
+    bool try_push(T&& item){
+      return push(&item, 1) == 1;
+    }
+
+    /*
+     * Consumer: move up to max items out, returns how many were taken
+    */
+    std::size_t pop(T* out, std::size_t max){
+      const std::size_t head = head_m.load(std::memory_order_relaxed);
+      if(cached_tail_m - head < max)
+        cached_tail_m = tail_m.load(std::memory_order_acquire);
+      std::size_t n = cached_tail_m - head;
+      if(n > max)
+        n = max;
+      for(std::size_t i = 0; i < n; ++i)
+        out[i] = std::move(slots_m[(head + i) & mask_m]);
+      head_m.store(head + n, std::memory_order_release);
+      return n;
+    }
+
+    bool try_pop(T& out){
+      return pop(&out, 1) == 1;
+    }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/*
+ * Packed symbol key
+ *
+ * SYMBOL is at most 8 alpha-numeric characters, so it fits in a single
+ * uint64_t (zero padded). Hashing and comparing the key is a single
+ * integer operation instead of a string hash.
+*/
+typedef uint64_t symbol_key_t;
+
+const std::size_t MAX_SYMBOL_LEN = 8;
+
+inline symbol_key_t symbol_key(std::string_view symbol){
+  symbol_key_t key = 0;
+  std::memcpy(&key, symbol.data(), symbol.size() < MAX_SYMBOL_LEN ? symbol.size() : MAX_SYMBOL_LEN);
+  return key;
+}
+
+/*
+ * Symbol of a key, the inverse of symbol_key
+ *
+ * The key is zero padded, its first zero byte ends the symbol. The
+ * view points into key, which must outlive it.
+*/
+inline std::string_view key_symbol(const symbol_key_t& key){
+  const char* p = reinterpret_cast<const char*>(&key);
+  return std::string_view(p, strnlen(p, MAX_SYMBOL_LEN));
+}
+
+#endif